@@ -2,13 +2,17 @@
 #include <iostream>			// Formatted output
 #include <ctime>			// For stopwatch
 #include <cmath>            // Math routines
-#include <thread>			// To parallelize computation
 #include <limits>           // To use infinity
 #include <iomanip>			// For printing arrays
+#include <cstdlib>			// For reading the environment
 #include "Bitmask.h"		// Array class for storing bits
 #include "Matrix.h"			// Data matrix class
-#include "SharedVector.h"	// Vector to be used across multiple threads
+#include "ClusterGroups.h"	// Registers grouped by cluster
+#include "ClusterScheduler.h"	// Queue of clusters to train
+#include "ThreadPool.h"		// Persistent worker threads
 #include "SVM_Trainer.h"	// Performs SVM
+#include "Statistics.h"		// Column statistics kernels
+#include "Splitting.h"		// Cluster assignment kernels
 #include <fstream> 			// Handles file operations
 #include <unistd.h>
 
@@ -21,24 +25,74 @@ typedef struct {
 } clusterStruct;
 
 
-int* powArr;					// Array to hold pre-calculated powers in base K
-
 // Function declarations:
-Bitmask* binaryClustering(Matrix* matrix);
-void findCentroids(int threadId, data_t* centroids, data_t* stdDev, Matrix* matrix);
-void clusterSplitting(int threadId, Matrix* boundaries, SharedVector<int>** clusterPtrs, Matrix* matrix);
-void checkContamination(int threadId, Matrix* matrix);
-void pickSupportVectors(int threadId, SharedVector<int>** clusterPtrs, struct svm_parameter param, Bitmask* chosen, Matrix* matrix);
-void pickRegisters(int threadId, Bitmask* chosen, Matrix* matrix);
+Bitmask* binaryClustering(Matrix* matrix, int numThreads, bool linearSolver);
+int parseThreadCount(const char* text);
+void findCentroids(int start, int end, data_t* centroids, data_t* stdDev, Matrix* matrix);
+bool centroidsByRows(Matrix* matrix, int numThreads);
+void findPartialStats(int start, int end, columnStats* partials, Matrix* matrix);
+void clusterSplitting(int start, int end, Matrix* boundaries, ClusterHistogram* histogram, Matrix* matrix);
+void relabelClusters(int start, int end, vector<int>* remap, Matrix* matrix);
+void checkContamination(int start, int end, Matrix* matrix);
+void pickSupportVectors(ClusterScheduler* scheduler, ClusterGroups* clusterGroups, struct svm_parameter param, Bitmask* chosen, Matrix* matrix);
+void trainCluster(int cluster, ClusterGroups* clusterGroups, struct svm_parameter param, Bitmask* chosen, Matrix* matrix, ThreadPool* cascadePool);
+void svmParallelFor(void* pool, int begin, int end, void (*body)(int start, int end, void* arg), void* arg);
+void pickRegisters(int start, int end, ClusterGroups* clusterGroups, Bitmask* chosen, Matrix* matrix);
 void printArray(data_t* arr, int size);
-struct svm_parameter setSVMParams();
+struct svm_parameter setSVMParams(bool linearSolver);
+
 
+// Main program. Usage:
+//   clustering [--threads N] [--linear-solver] [datasetFile]	runs the algorithm on datasetFile (text or binary format)
+//   clustering --convert textFile binaryFile					converts a text dataset into the binary columnar format
+// Without --threads, the number of threads is taken from the THREADS_ENV environment variable and, if it
+// is not set either, from the CPUs available to the process. --linear-solver trains clusters with dual
+// coordinate descent instead of SMO, which is faster but solves the bias-regularized (LIBLINEAR) problem,
+// so it picks different registers:
+int main(int argc, char* argv[]){
+
+	// Checks if a conversion was requested instead of a run:
+	if ((argc == 4) && (string(argv[1]) == "--convert")){
+		return (Matrix::convertToBinary(argv[2], argv[3]) == true) ? 0 : 1;
+	}
+
+	// Defaults to every CPU available:
+	int numThreads = ThreadPool::availableThreads();
+	const char* datasetFile = "/home/cemarciano/Documents/fullDataset.txt";
+	bool linearSolver = false;
+
+	// Checks environment for a thread count:
+	if (getenv(THREADS_ENV) != NULL){
+		numThreads = parseThreadCount(getenv(THREADS_ENV));
+		if (numThreads == 0){
+			cout << "Invalid thread count " << THREADS_ENV << "=" << getenv(THREADS_ENV) << "." << endl;
+			return 1;
+		}
+	}
 
-// Main program:
-int main(){
+	// Loops through arguments (the command line wins over the environment):
+	for (int a = 1; a < argc; a++){
+		if (string(argv[a]) == "--threads"){
+			numThreads = (a+1 < argc) ? parseThreadCount(argv[++a]) : 0;
+			if (numThreads == 0){
+				cout << "--threads expects a positive number of threads." << endl;
+				return 1;
+			}
+		} else if (string(argv[a]) == "--linear-solver"){
+			linearSolver = true;
+		} else {
+			datasetFile = argv[a];
+		}
+	}
+	cout << "Using " << numThreads << " threads." << endl;
+	cout << "Using " << columnStatsKernel() << " kernel for column statistics." << endl;
+	cout << "Using " << assignBinsKernel() << " kernel for cluster assignment." << endl;
 
 	// Loads the data matrix:
-	Matrix data("/home/cemarciano/Documents/fullDataset.txt", true);
+	Matrix data(datasetFile, true, numThreads);
+	if (data.isLoaded() == false){
+		return 1;
+	}
 
     // Starts the stopwatch:
 	struct timespec start, finish;
@@ -46,7 +100,7 @@ int main(){
     cout << "Start!" << endl;
 
     // Runs binary clustering algorithm:
-    Bitmask* chosen = binaryClustering(&data);
+    Bitmask* chosen = binaryClustering(&data, numThreads, linearSolver);
 
 	// Stops the stopwatch:
 	clock_gettime(CLOCK_MONOTONIC, &finish);
@@ -83,7 +137,30 @@ int main(){
 
 
 
-Bitmask* binaryClustering(Matrix* matrix){
+// Retrieves the positive number of threads written in text, or 0 if text is not one:
+int parseThreadCount(const char* text){
+	char* end;
+	long count = strtol(text, &end, 10);
+	// Rejects empty text, trailing characters and absurd values:
+	if ((end == text) || (*end != '\0') || (count <= 0) || (count > MAX_THREADS)){
+		return 0;
+	}
+	return count;
+}
+
+
+Bitmask* binaryClustering(Matrix* matrix, int numThreads, bool linearSolver){
+
+	// Checks if cluster codes can hold every dimension:
+	if (codeFits(matrix->getDims()) == false){
+		cout << "Cluster codes of " << CODE_WORDS << " words hold at most " << CODE_WORDS*codeDimsPerWord()
+			 << " dimensions with K = " << K << ", but data has " << matrix->getDims() << ". Please raise CODE_WORDS." << endl;
+		// Chooses nothing:
+		return new Bitmask(matrix->getRows());
+	}
+
+	// Threads shared by every stage:
+	ThreadPool pool(numThreads);
 
     /****************************/
     /*** CENTROID CALCULATION ***/
@@ -94,18 +171,35 @@ Bitmask* binaryClustering(Matrix* matrix){
 	// Allocates stddev array:
     data_t* stdDev = new data_t[ matrix->getDims() ]();
 
-    // Array of threads:
-	thread centroidTasks[CORES];
+	// Checks if threads should split rows instead of columns:
+	if (centroidsByRows(matrix, numThreads)){
 
-	// Loops through threads:
-	for (int threadId = 0; threadId < CORES; threadId++){
-		// Fires up thread to fill matrix:
-		centroidTasks[threadId] = thread(findCentroids, threadId, centroids, stdDev, matrix);
-	}
+		// Allocates partial statistics of every dimension for each thread:
+		columnStats* partials = new columnStats[numThreads * matrix->getDims()];
+
+		// Each thread summarizes its slice of rows:
+		pool.parallelFor(0, matrix->getRows(), [&](int start, int end, int threadId){
+			findPartialStats(start, end, &partials[threadId*matrix->getDims()], matrix);
+		});
+
+		// Merges partials in thread order, so results don't depend on timing:
+		for (int j = 0; j < matrix->getDims(); j++){
+			columnStats stats = partials[j];
+			for (int threadId = 1; threadId < numThreads; threadId++){
+				stats = mergeColumnStats(stats, partials[threadId*matrix->getDims() + j]);
+			}
+			centroids[j] = stats.mean;
+			stdDev[j] = sqrt(stats.m2/matrix->getRows());
+		}
+
+		delete[] partials;
+
+	} else {
 
-	// Waits until all threads are done:
-	for (int threadId = 0; threadId < CORES; threadId++){
-		centroidTasks[threadId].join();
+		// Each thread summarizes its slice of columns:
+		pool.parallelFor(0, matrix->getDims(), [&](int start, int end, int /*threadId*/){
+			findCentroids(start, end, centroids, stdDev, matrix);
+		});
 	}
 
     // Prints centroid values:
@@ -157,34 +251,31 @@ Bitmask* binaryClustering(Matrix* matrix){
     /*************************/
 
 
-    // Array containing future indexes of clusters (in base K):
-    powArr = new int[ matrix->getDims() ];
-    // Fills the array with powers of the number of divisions:
-    for (int i = 0; i < matrix->getDims(); i++){
-        powArr[i] = pow(K,i);
-    }
-
-
-	// Creates one shared vector pointer for each cluster.
-	// A position in this array is a shared vector containing the IDs of the registers in that cluster:
-	int totalClusters = pow(K,matrix->getDims());
-	SharedVector<int>** clusterPtrs = new SharedVector<int>*[totalClusters]();
-
 
+	// Clusters occupied by each thread's slice, so threads never share counters while splitting:
+	vector<ClusterHistogram> histograms(numThreads);
 
-    // Array of threads:
-	std::thread splittingTasks[CORES];
+	// Each thread splits its slice of rows:
+	pool.parallelFor(0, matrix->getRows(), [&](int start, int end, int threadId){
+		clusterSplitting(start, end, &boundaries, &histograms[threadId], matrix);
+	});
 
-	// Loops through threads:
-	for (int threadId = 0; threadId < CORES; threadId++){
-		// Fires up thread to split the space:
-		splittingTasks[threadId] = thread(clusterSplitting, threadId, &boundaries, clusterPtrs, matrix);
+	// Merges histograms in slice order, so cluster indices and counts match a sequential pass:
+	vector<vector<int>> remaps(numThreads);
+	for (int threadId = 0; threadId < numThreads; threadId++){
+		remaps[threadId] = matrix->mergeHistogram(&histograms[threadId]);
 	}
 
-	// Waits until all threads are done:
-	for (int threadId = 0; threadId < CORES; threadId++){
-		splittingTasks[threadId].join();
-	}
+	// Each thread translates the local cluster indices of the same slice (the first slice's local
+	// indices are already the final ones):
+	pool.parallelFor(0, matrix->getRows(), [&](int start, int end, int threadId){
+		if (threadId > 0){
+			relabelClusters(start, end, &remaps[threadId], matrix);
+		}
+	});
+
+	// Groups registers by cluster, so each cluster's registers are one contiguous span:
+	ClusterGroups clusterGroups(matrix, &pool);
 
 	// Saves cluster distribution:
 	matrix->saveClusterDist();
@@ -194,19 +285,10 @@ Bitmask* binaryClustering(Matrix* matrix){
     /*** CHECK CONTAMINATION OF CLUSTERS ***/
     /***************************************/
 
-	// Array of threads:
-	std::thread contaminationTasks[CORES];
-
-	// Loops through threads:
-	for (int threadId = 0; threadId < CORES; threadId++){
-		// Fires up thread to check contamination:
-		contaminationTasks[threadId] = thread(checkContamination, threadId, matrix);
-	}
-
-	// Waits until all threads are done:
-	for (int threadId = 0; threadId < CORES; threadId++){
-		contaminationTasks[threadId].join();
-	}
+	// Each thread checks its slice of clusters:
+	pool.parallelFor(0, matrix->getTotalClusters(), [&](int start, int end, int /*threadId*/){
+		checkContamination(start, end, matrix);
+	});
 
 
 	/*******************/
@@ -217,46 +299,46 @@ Bitmask* binaryClustering(Matrix* matrix){
 	Bitmask* chosen = new Bitmask(matrix->getRows());
 
 	// Sets SVM parameters:
-	struct svm_parameter param = setSVMParams();
-
-	// Array of threads:
-	std::thread SVMTasks[CORES];
-
-	// Loops through threads:
-	for (int threadId = 0; threadId < CORES; threadId++){
-		// Fires up thread to perform SVM tasks:
-		SVMTasks[threadId] = thread(pickSupportVectors, threadId, clusterPtrs, param, chosen, matrix);
+	struct svm_parameter param = setSVMParams(linearSolver);
+
+	// Queues clusters to train, largest first:
+	ClusterScheduler scheduler(matrix, &clusterGroups);
+
+	// Solvers that evaluate kernel columns (dual coordinate descent has none, and its cost only grows linearly
+	// with registers) train the largest clusters one at a time, using every thread: the largest ones as
+	// cascades of smaller problems trained in parallel, and the rest by filling columns and updating the
+	// gradient on every thread inside the solver:
+	if (!((param.kernel_type == LINEAR) && param.linear_solver)){
+		struct svm_parallel parallel = {svmParallelFor, &pool, SVM_PARALLEL_MIN_LEN};
+		struct svm_parameter largeParam = param;
+		largeParam.parallel = (numThreads > 1) ? &parallel : NULL;
+		int minLarge = (numThreads > 1) ? min(SVM_PARALLEL_MIN_CLUSTER, CASCADE_MIN_CLUSTER) : CASCADE_MIN_CLUSTER;
+		int cluster;
+		while (scheduler.next(minLarge, &cluster) == true){
+			bool cascade = (clusterGroups.getSize(cluster) >= CASCADE_MIN_CLUSTER);
+			trainCluster(cluster, &clusterGroups, largeParam, chosen, matrix, (cascade == true) ? &pool : NULL);
+		}
 	}
 
-	// Waits until all threads are done:
-	for (int threadId = 0; threadId < CORES; threadId++){
-		SVMTasks[threadId].join();
-	}
+	// Every thread trains the remaining clusters from the queue until it is empty:
+	pool.run([&](int /*threadId*/){
+		pickSupportVectors(&scheduler, &clusterGroups, param, chosen, matrix);
+	});
 
 	/**********************/
     /*** RANDOM PICKING ***/
     /**********************/
 
 
-	// Array of threads:
-	std::thread pickerTasks[CORES];
-
-	// Loops through threads:
-	for (int threadId = 0; threadId < CORES; threadId++){
-		// Fires up thread to fill matrix:
-		pickerTasks[threadId] = thread(pickRegisters, threadId, chosen, matrix);
-	}
-
-	// Waits until all threads are done:
-	for (int threadId = 0; threadId < CORES; threadId++){
-		pickerTasks[threadId].join();
-	}
+	// Threads claim chunks of clusters as they become free, since cluster sizes are very uneven:
+	pool.parallelFor(0, matrix->getTotalClusters(), [&](int start, int end, int /*threadId*/){
+		pickRegisters(start, end, &clusterGroups, chosen, matrix);
+	}, SCHEDULE_GUIDED, PICK_MIN_CHUNK);
 
 
 	// Deletes allocated space:
 	delete[] centroids;
 	delete[] stdDev;
-	delete[] powArr;
 
 	// Returns chosen data:
 	return chosen;
@@ -264,98 +346,97 @@ Bitmask* binaryClustering(Matrix* matrix){
 }
 
 
-// Job to calculate the centroid for each dimension:
-void findCentroids(int threadId, data_t* centroids, data_t* stdDev, Matrix* matrix){
-
-    // Number of columns to sum:
-	double each = (matrix->getDims())*1.0 / CORES;
+// Job to calculate the centroid for each dimension in [start, end):
+void findCentroids(int start, int end, data_t* centroids, data_t* stdDev, Matrix* matrix){
 
-    // Calculates chunck:
-    int start = round(threadId*each);
-    int end = round((threadId+1)*each);
+	int rows = matrix->getRows();
 
     // Loops through designated columns:
 	for (int j = start; j < end; j++){
+		// Calculates mean and squared deviations in a single pass over the column:
+		columnStats stats = computeColumnStats(matrix->getColumn(j), matrix->getColumnStep(), rows);
+        // Writes centroid:
+        centroids[j] = stats.mean;
+        // Writes stddev:
+        stdDev[j] = sqrt(stats.m2/rows);
+    }
+
+}
 
-		// CENTROID:
 
-        // Accumulator:
-        data_t acc = 0;
-        // Loops through lines:
-		for (int i = 0; i < matrix->getRows(); i++){
-            acc += matrix->get(i, j);
-        }
-        // Writes accumulator mean:
-        centroids[j] = acc / matrix->getRows();
-
-		// STDDEV:
-
-		// Accumulator:
-        acc = 0;
-		// Current centroid:
-		data_t currCentroid = centroids[j];
-        // Loops through lines:
-		for (int i = 0; i < matrix->getRows(); i++){
-            acc += pow( matrix->get(i, j) - currCentroid, 2);
-        }
-        // Writes accumulator stddev:
-        stdDev[j] = sqrt(acc/matrix->getRows());
-    }
 
+// Checks if centroid threads should split rows instead of columns. Splitting columns needs no merging,
+// but leaves threads idle when there are fewer dimensions than threads or they don't divide evenly.
+// Rows are split then, as long as each thread gets at least CENTROID_MIN_ROWS of them:
+bool centroidsByRows(Matrix* matrix, int numThreads){
+	int dims = matrix->getDims();
+	// Rows each thread would summarize:
+	double rowsEach = (matrix->getRows())*1.0 / numThreads;
+	// Splits rows when columns can't keep every thread equally busy and slices are worth the merge:
+	return ((dims < numThreads) || ((dims % numThreads) != 0)) && (rowsEach >= CENTROID_MIN_ROWS);
 }
 
 
+// Job to summarize every dimension over rows [start, end), saving results in partials[j]:
+void findPartialStats(int start, int end, columnStats* partials, Matrix* matrix){
 
-// Job to assign a cluster number to each register:
-void clusterSplitting(int threadId, Matrix* boundaries, SharedVector<int>** clusterPtrs, Matrix* matrix){
+	long long step = matrix->getColumnStep();
 
-    // Number of lines to check:
-	double each = (matrix->getRows())*1.0 / CORES;
+    // Loops through all columns:
+	for (int j = 0; j < matrix->getDims(); j++){
+		// Summarizes designated rows of this column in a single pass:
+		partials[j] = computeColumnStats(matrix->getColumn(j) + start*step, step, end - start);
+	}
 
-    // Calculates chunck:
-    int start = round(threadId*each);
-    int end = round((threadId+1)*each);
+}
 
-    // Loops through designated lines:
-	for (int i = start; i < end; i++){
-        // Memory position accumulator:
-        int memAcc = 0;
-        // Loops through columns:
+
+// Job to assign a cluster number to each register in [start, end):
+void clusterSplitting(int start, int end, Matrix* boundaries, ClusterHistogram* histogram, Matrix* matrix){
+
+	long long step = matrix->getColumnStep();
+
+	// Words of the cluster codes of the registers in the current block (codes[w][i] is word w of register i):
+	unsigned long long codes[CODE_WORDS][SPLIT_BLOCK];
+
+    // Loops through designated lines, one block at a time:
+	for (int blockStart = start; blockStart < end; blockStart += SPLIT_BLOCK){
+		int count = min(SPLIT_BLOCK, end - blockStart);
+        // Memory position accumulators:
+		for (int w = 0; w < CODE_WORDS; w++){
+			fill(codes[w], codes[w] + count, 0);
+		}
+        // Loops through columns, packing each dimension's bin into the whole block:
         for (int j = 0; j < matrix->getDims(); j++){
-            // Loops through boundaries:
-            for (int k = 0; k < K; k++){
-                // Checks if data is to the left of boundary:
-                if (matrix->get(i, j) < boundaries->get(j, k)){
-                    // Moves the memory position further (sets 1 in bitmask, represented in 10s):
-                    memAcc += powArr[j]*k;
-                    break;
-                }
-            }
+			assignBins(matrix->getColumn(j) + blockStart*step, step, count, boundaries->getRow(j), K-1, codeShiftOf(j), codes[codeWordOf(j)]);
         }
 
-        // Assigns a cluster to the data:
-        matrix->putClusterOf(i, memAcc);
-
-		// Inserts data into corresponding cluster.
-		// Checks if cluster is empty:
-		if (clusterPtrs[memAcc] == NULL){
-			// Allocates space for this cluster:
-			clusterPtrs[memAcc] = new SharedVector<int>(CORES);
+		// Loops through registers of the block:
+		for (int i = blockStart; i < blockStart + count; i++){
+			// Gathers the words of this register's code:
+			clusterCode code;
+			for (int w = 0; w < CODE_WORDS; w++){
+				code.words[w] = codes[w][i - blockStart];
+			}
+			// Counts the register in its cluster and saves the slice's local index of that cluster:
+			matrix->putClusterIndexOf(i, histogram->add(code, matrix->getClassOf(i)));
 		}
-		// Pushes register to cluster:
-		(clusterPtrs[memAcc])->push(i, threadId);
     }
 }
 
 
-// Job to assign a cluster number to each register:
-void checkContamination(int threadId, Matrix* matrix){
+// Job to translate the local cluster indices of registers [start, end) into indices of the merged clusters:
+void relabelClusters(int start, int end, vector<int>* remap, Matrix* matrix){
+
+    // Loops through designated lines:
+	for (int i = start; i < end; i++){
+		matrix->putClusterIndexOf(i, (*remap)[matrix->getClusterOf(i)]);
+	}
+}
 
-	// Number of chuncks to check:
-	double each = (pow(K, matrix->getDims()))*1.0 / CORES;
-    // Calculates chunck:
-    int start = round(threadId*each);
-    int end = round((threadId+1)*each);
+
+// Job to assign a cluster number to each register:
+void checkContamination(int start, int end, Matrix* matrix){
 
 	// Loops through designated clusters:
 	for (int i = start; i < end; i++){
@@ -417,84 +498,99 @@ void checkContamination(int threadId, Matrix* matrix){
 
 
 // Job to perform SVM and retain support vectors:
-void pickSupportVectors(int threadId, SharedVector<int>** clusterPtrs, struct svm_parameter param, Bitmask* chosen, Matrix* matrix){
-
-	// Number of chuncks to check:
-	double each = (pow(K, matrix->getDims()))*1.0 / CORES;
-    // Calculates chunck:
-    int start = round(threadId*each);
-    int end = round((threadId+1)*each);
+void pickSupportVectors(ClusterScheduler* scheduler, ClusterGroups* clusterGroups, struct svm_parameter param, Bitmask* chosen, Matrix* matrix){
 
-	// Loops through designated clusters:
-	for (int cluster = start; cluster < end; cluster++){
-		// Checks if cluster is eligible for SVM task (i.e. has at least one register of both classes):
-		if (matrix->getHasBothClasses(cluster) == true){
-			// Fires up SVM:
-			SVM_Trainer result(matrix, clusterPtrs[cluster], param);
-			// Retrieves each support vector:
-			for (int i = 0; i < result.getTotalSV(); i++){
-				// Gets register index:
-				int regId = result.getSV(i);
-				// Marks register as chosen:
-				chosen->put(regId+1, true);
-				// Reduces total available registers to be picked according to class:
-				if (matrix->getClassOf(regId) == 0){
-					// Gets how many more signal registers this cluster can still yield:
-					int yield = matrix->getSignalDist(cluster);
-					// Subtracts signal yield for this cluster, effectively "taking" one register:
-					matrix->putSignalDist(cluster, yield-1);
-				} else {
-					// Gets how many more background registers this cluster can still yield:
-					int yield = matrix->getBackgroundDist(cluster);
-					// Subtracts background yield for this cluster, effectively "taking" one register:
-					matrix->putBackgroundDist(cluster, yield-1);
-				}
-			}
-		}
+	// Claims eligible clusters (i.e. with at least one register of both classes) until none are left:
+	int cluster;
+	while (scheduler->next(&cluster) == true){
+		trainCluster(cluster, clusterGroups, param, chosen, matrix, NULL);
 	}
 
 }
 
-// Job to pick which registers should be kept:
-void pickRegisters(int threadId, Bitmask* chosen, Matrix* matrix){
-
-    // Number of lines to check:
-	double each = (matrix->getRows())*1.0 / CORES;
-
-    // Calculates chunck:
-    int start = round(threadId*each);
-    int end = round((threadId+1)*each);
-
-    // Loops through designated lines:
-	for (int i = start; i < end; i++){
-
-		// Retrieves cluster of current register:
-		int cluster = matrix->getClusterOf(i);
 
-		// Checks this register belongs to class 0 (signal):
-		if (matrix->getClassOf(i) == 0){
+// Performs SVM on a cluster and retains its support vectors. If cascadePool is given, the cluster is
+// trained as a cascade SVM on its threads:
+void trainCluster(int cluster, ClusterGroups* clusterGroups, struct svm_parameter param, Bitmask* chosen, Matrix* matrix, ThreadPool* cascadePool){
+	// Fires up SVM:
+	SVM_Trainer result(matrix, clusterGroups->getMembers(cluster), clusterGroups->getSize(cluster), param, cascadePool);
+	// Retrieves each support vector:
+	for (int i = 0; i < result.getTotalSV(); i++){
+		// Gets register index:
+		int regId = result.getSV(i);
+		// Marks register as chosen (other threads write neighbouring registers):
+		chosen->putAtomic(regId+1, true);
+		// Reduces total available registers to be picked according to class:
+		if (matrix->getClassOf(regId) == 0){
 			// Gets how many more signal registers this cluster can still yield:
 			int yield = matrix->getSignalDist(cluster);
-			// Checks if given cluster can still yield signal registers:
-			if (yield > 0){
-				// Subtracts signal yield for this cluster, effectively "taking" one register:
-				matrix->putSignalDist(cluster, yield-1);
-				// Marks register i as chosen:
-				chosen->put(i+1, true);
-			}
-		// Case where register belongs to class 1 (background):
+			// Subtracts signal yield for this cluster, effectively "taking" one register:
+			matrix->putSignalDist(cluster, yield-1);
 		} else {
 			// Gets how many more background registers this cluster can still yield:
 			int yield = matrix->getBackgroundDist(cluster);
-			// Checks if given cluster can still yield background registers:
-			if (yield > 0){
-				// Subtracts background yield for this cluster, effectively "taking" one register:
-				matrix->putBackgroundDist(cluster, yield-1);
-				// Marks register i as chosen:
-				chosen->put(i+1, true);
+			// Subtracts background yield for this cluster, effectively "taking" one register:
+			matrix->putBackgroundDist(cluster, yield-1);
+		}
+	}
+}
+
+
+// Runs libsvm loops on the threads of a ThreadPool, split in one slice per thread taking part:
+void svmParallelFor(void* pool, int begin, int end, void (*body)(int start, int end, void* arg), void* arg){
+	ThreadPool* threads = (ThreadPool*) pool;
+	// Every thread taking part gets at least SVM_PARALLEL_MIN_LEN elements, so its share pays for waking it up:
+	int slices = min(threads->getNumThreads(), (end - begin) / SVM_PARALLEL_MIN_LEN);
+	if (slices < 2){
+		body(begin, end, arg);
+		return;
+	}
+	threads->run([&](int threadId){
+		double each = (end - begin)*1.0 / slices;
+		body(begin + round(threadId*each), begin + round((threadId+1)*each), arg);
+	}, slices);
+}
+
+// Job to pick which registers should be kept. Each thread owns whole clusters, so their yields are never
+// shared, and registers are taken in increasing order inside each cluster:
+void pickRegisters(int start, int end, ClusterGroups* clusterGroups, Bitmask* chosen, Matrix* matrix){
+
+	// Loops through designated clusters:
+	for (int cluster = start; cluster < end; cluster++){
+
+		// Gets how many more registers of each class this cluster can still yield:
+		int signalYield = matrix->getSignalDist(cluster);
+		int backgroundYield = matrix->getBackgroundDist(cluster);
+
+		// Loops through registers of the cluster:
+		const int* members = clusterGroups->getMembers(cluster);
+		for (int k = 0; k < clusterGroups->getSize(cluster); k++){
+			int i = members[k];
+
+			// Checks this register belongs to class 0 (signal):
+			if (matrix->getClassOf(i) == 0){
+				// Checks if given cluster can still yield signal registers:
+				if (signalYield > 0){
+					// Subtracts signal yield for this cluster, effectively "taking" one register:
+					signalYield--;
+					// Marks register i as chosen (other threads write neighbouring registers):
+					chosen->putAtomic(i+1, true);
+				}
+			// Case where register belongs to class 1 (background):
+			} else {
+				// Checks if given cluster can still yield background registers:
+				if (backgroundYield > 0){
+					// Subtracts background yield for this cluster, effectively "taking" one register:
+					backgroundYield--;
+					// Marks register i as chosen (other threads write neighbouring registers):
+					chosen->putAtomic(i+1, true);
+				}
 			}
 		}
 
+		// Saves what is left of the yields:
+		matrix->putSignalDist(cluster, signalYield);
+		matrix->putBackgroundDist(cluster, backgroundYield);
 	}
 }
 
@@ -511,7 +607,7 @@ void printArray(data_t* arr, int size){
 
 
 // Set all default parameters for param struct:
-struct svm_parameter setSVMParams(){
+struct svm_parameter setSVMParams(bool linearSolver){
 	// Decares struct:
 	struct svm_parameter param;
 	// Sets parameters:
@@ -527,6 +623,8 @@ struct svm_parameter setSVMParams(){
 	param.p = 0.1;
 	param.shrinking = 1;
 	param.probability = 0;
+	param.linear_solver = linearSolver;	// dual coordinate descent instead of SMO (linear kernel only)
+	param.parallel = NULL;		// each cluster is trained on a single thread
 	param.nr_weight = 0;
 	param.weight_label = NULL;
 	param.weight = NULL;
@@ -1,8 +1,7 @@
 #ifndef BITMASK_H
 #define BITMASK_H
-#include <bitset>
 
-#define B_SIZE 8
+#define B_SIZE 64
 
 class Bitmask {
     public:
@@ -12,10 +11,14 @@ class Bitmask {
 		// Returns the boolean value of the i-th element:
         bool get(int i);
 
-		// Puts value in the i-th position:
+		// Puts value in the i-th position. Not safe while other threads write positions of the same word:
         void put(int i, bool value);
 
-        // Returns the number of TRUE elements in O(n):
+		// Puts value in the i-th position with an atomic read-modify-write on its word, so threads may
+		// write neighbouring positions concurrently without losing bits:
+		void putAtomic(int i, bool value);
+
+        // Returns the number of TRUE elements, counting a word at a time:
         int getSize();
 
 		// Returns total allocated length:
@@ -30,15 +33,45 @@ class Bitmask {
 		// Checks if this bitmask and bitmask R have the same value for all elements:
         bool equals(Bitmask* R);
 
+		// Keeps TRUE only the elements that are also TRUE in bitmask R (of the same length):
+		void andWith(Bitmask* R);
+
+		// Sets TRUE every element that is TRUE in bitmask R (of the same length):
+		void orWith(Bitmask* R);
+
+		// Sets FALSE every element that is TRUE in bitmask R (of the same length):
+		void andNotWith(Bitmask* R);
+
+		// Returns the first position after i holding TRUE, or 0 if there is none. Loop over set
+		// elements with: for (int i = b.nextSet(0); i != 0; i = b.nextSet(i))
+		int nextSet(int i);
+
+		// Calls f(i) for every position i holding TRUE, in increasing order:
+		template <class F> void forEachSet(F f){
+			for (int w = 0; w < totalWords; w++){
+				unsigned long long word = vArray[w];
+				while (word != 0){
+					f(w*B_SIZE + __builtin_ctzll(word) + 1);
+					// Clears lowest set bit:
+					word &= word - 1;
+				}
+			}
+		}
+
 		// Prints out the index of the elements containing values equal to trueOrFalse:
 		void printIDs(bool trueOrFalse);
 
 		// Destructor:
         ~Bitmask();
     protected:
+
+		// Checks if bitmask R has the same length as this one, printing an error otherwise:
+		bool sameLength(Bitmask* R);
+
     private:
-        std::bitset<8>* vArray;
-        int bitmaskLength;
+        unsigned long long* vArray;		// Bit i-1 of the mask is bit (i-1)%B_SIZE of word (i-1)/B_SIZE. Bits past the length are always 0
+        int bitmaskLength;				// Total number of elements
+        int totalWords;					// Total number of words in vArray
 };
 
 #endif // BITMASK_H
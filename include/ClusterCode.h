@@ -0,0 +1,91 @@
+#ifndef CLUSTERCODE_H
+#define CLUSTERCODE_H
+
+#include <string>
+#include "global.h"			// General configuration file
+
+// Identifies a cluster by the bin of each dimension. Bins are packed into fields of codeBits()
+// bits, codeDimsPerWord() fields per 64-bit word (fields never straddle words), so dimension j
+// lives in word codeWordOf(j) at bit codeShiftOf(j):
+typedef struct clusterCode {
+	unsigned long long words[CODE_WORDS];
+
+	// Checks if two codes identify the same cluster:
+	bool operator==(const clusterCode& R) const {
+		for (int w = 0; w < CODE_WORDS; w++){
+			if (words[w] != R.words[w]) return false;
+		}
+		return true;
+	}
+} clusterCode;
+
+// Retrieves the number of bits needed to hold a bin, ceil(log2 K):
+inline int codeBits(){
+	int bits = 1;
+	while ((1 << bits) < K) bits++;
+	return bits;
+}
+
+// Retrieves how many dimensions fit in one word:
+inline int codeDimsPerWord(){
+	return 64 / codeBits();
+}
+
+// Retrieves the word holding the bin of dimension j:
+inline int codeWordOf(int j){
+	return j / codeDimsPerWord();
+}
+
+// Retrieves the position of the lowest bit of dimension j inside its word:
+inline int codeShiftOf(int j){
+	return (j % codeDimsPerWord()) * codeBits();
+}
+
+// Checks if codes of dims dimensions fit in CODE_WORDS words:
+inline bool codeFits(int dims){
+	return dims <= CODE_WORDS * codeDimsPerWord();
+}
+
+// Retrieves a code with every bin set to 0:
+inline clusterCode emptyCode(){
+	clusterCode code;
+	for (int w = 0; w < CODE_WORDS; w++){
+		code.words[w] = 0;
+	}
+	return code;
+}
+
+// Saves bin as the bin of dimension j (the field must still be 0):
+inline void packBin(clusterCode& code, int j, int bin){
+	code.words[codeWordOf(j)] |= ((unsigned long long) bin) << codeShiftOf(j);
+}
+
+// Retrieves the bin of dimension j:
+inline int unpackBin(const clusterCode& code, int j){
+	return (code.words[codeWordOf(j)] >> codeShiftOf(j)) & ((1ULL << codeBits()) - 1);
+}
+
+// Mixes every word of a code into 64 bits (finalizer of splitmix64, chained across words):
+inline unsigned long long hashCode(const clusterCode& code){
+	unsigned long long h = 0;
+	for (int w = 0; w < CODE_WORDS; w++){
+		unsigned long long x = h ^ code.words[w];
+		x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+		x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+		h = x ^ (x >> 31);
+	}
+	return h;
+}
+
+// Writes the bins of the first dims dimensions, last dimension first (for K <= 10 this is the
+// cluster number written in base K):
+inline std::string codeToString(const clusterCode& code, int dims){
+	std::string digits;
+	for (int j = dims-1; j >= 0; j--){
+		digits += std::to_string(unpackBin(code, j));
+		if ((K > 10) && (j != 0)) digits += ".";
+	}
+	return digits;
+}
+
+#endif // CLUSTERCODE_H
@@ -0,0 +1,49 @@
+#ifndef CLUSTERGROUPS_H
+#define CLUSTERGROUPS_H
+
+#include <vector>
+#include "Matrix.h"			// Data matrix class
+#include "ThreadPool.h"		// Persistent worker threads
+
+#define GROUP_HISTOGRAM_RATIO 4		// Per-slice histograms may hold at most this many counters per register
+
+using namespace std;
+
+// Registers grouped by cluster in compressed sparse row layout: members of cluster c are the
+// contiguous span [getMembers(c), getMembers(c) + getSize(c)), in increasing register order:
+class ClusterGroups {
+    public:
+		// Constructor, groups the registers of matrix by the cluster they were assigned to using a
+		// counting sort (per-slice histograms, prefix sum and scatter) on the threads of pool:
+        ClusterGroups(Matrix* matrix, ThreadPool* pool);
+
+		// Retrieves the number of registers in a cluster:
+		int getSize(int cluster);
+
+		// Retrieves a pointer to the first register of a cluster:
+		const int* getMembers(int cluster);
+
+		// Retrieves total number of clusters:
+		int getTotalClusters();
+
+		// Destructor:
+        ~ClusterGroups();
+    protected:
+
+		// Job to count how many registers of each cluster lie in a slice of rows:
+		void countSlice(int slice);
+
+		// Job to write the registers of a slice of rows into their clusters:
+		void scatterSlice(int slice);
+
+    private:
+
+		Matrix* m_matrix;				// Data matrix whose registers are grouped
+		int m_numSlices;				// Total number of slices of rows
+		int m_totalClusters;			// Total number of clusters
+		vector<int> m_offsets;			// m_offsets of c holds where cluster c starts in m_members, m_offsets of C holds total registers
+		vector<int> m_members;			// Register indices, grouped by cluster
+		vector<int> m_positions;		// m_positions of s*C + c holds where slice s writes its next register of cluster c
+};
+
+#endif // CLUSTERGROUPS_H
@@ -0,0 +1,43 @@
+#ifndef CLUSTERHISTOGRAM_H
+#define CLUSTERHISTOGRAM_H
+
+#include <vector>
+#include "ClusterTable.h"		// Map of occupied clusters
+
+using namespace std;
+
+// Clusters occupied by one thread's slice of registers, with how many registers of each class fell
+// into each of them. Local indices follow the order in which the slice first reached each cluster,
+// so merging histograms in slice order reproduces the indices of a sequential pass:
+class ClusterHistogram {
+    public:
+		// Constructor:
+        ClusterHistogram();
+
+		// Counts a register of class classOf in the cluster with the given code, and retrieves the
+		// local index of that cluster:
+		int add(const clusterCode& code, int classOf);
+
+		// Retrieves the code of the cluster at local index:
+		clusterCode getCode(int index);
+
+		// Retrieves the number of signal registers counted in the cluster at local index:
+		int getSignalCount(int index);
+
+		// Retrieves the number of background registers counted in the cluster at local index:
+		int getBackgroundCount(int index);
+
+		// Retrieves the number of clusters occupied by this slice:
+		int getSize();
+
+		// Destructor:
+        ~ClusterHistogram();
+
+    private:
+
+		ClusterTable m_table;			// Maps codes seen by this slice to local indices
+		vector<int> m_signalCount;		// m_signalCount of i holds the signal registers counted in local cluster i
+		vector<int> m_backgroundCount;	// m_backgroundCount of i holds the background registers counted in local cluster i
+};
+
+#endif // CLUSTERHISTOGRAM_H
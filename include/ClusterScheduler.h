@@ -0,0 +1,40 @@
+#ifndef CLUSTERSCHEDULER_H
+#define CLUSTERSCHEDULER_H
+
+#include <vector>
+#include <atomic>
+#include "Matrix.h"			// Data matrix class
+#include "ClusterGroups.h"	// Registers grouped by cluster
+
+using namespace std;
+
+// Queue of the clusters eligible for SVM training (those holding registers of both classes), largest
+// first. Threads claim clusters one at a time as they finish the previous one, so a few huge clusters
+// end up on different threads and small ones fill the gaps:
+class ClusterScheduler {
+    public:
+		// Constructor, queues the eligible clusters of matrix by decreasing size in clusterGroups:
+        ClusterScheduler(Matrix* matrix, ClusterGroups* clusterGroups);
+
+		// Claims the next cluster in the queue, saving it in cluster. Returns false once the queue is
+		// empty. Safe to call from several threads:
+		bool next(int* cluster);
+
+		// Claims the next cluster in the queue only if it holds at least minSize registers, saving it in
+		// cluster. Returns false otherwise. Safe to call from several threads:
+		bool next(int minSize, int* cluster);
+
+		// Retrieves total number of queued clusters:
+		int getSize();
+
+		// Destructor:
+        ~ClusterScheduler();
+
+    private:
+
+		ClusterGroups* m_clusterGroups;	// Registers of each cluster
+		vector<int> m_queue;			// Eligible clusters, largest first
+		atomic<int> m_next;				// Position in m_queue of the next cluster to hand out
+};
+
+#endif // CLUSTERSCHEDULER_H
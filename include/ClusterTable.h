@@ -0,0 +1,45 @@
+#ifndef CLUSTERTABLE_H
+#define CLUSTERTABLE_H
+
+#include <vector>
+#include "ClusterCode.h"		// Packed cluster codes
+
+#define TABLE_MIN_SLOTS 1024		// Initial number of slots in a cluster table (must be a power of 2)
+
+using namespace std;
+
+// Maps the cluster codes that actually occur to dense indices [0, getSize()), in order of first
+// insertion, using an open-addressing hash table with linear probing. Memory grows with the number
+// of occupied clusters instead of with K^D:
+class ClusterTable {
+    public:
+		// Constructor:
+        ClusterTable();
+
+		// Retrieves the index of the cluster with the given code, creating it if needed:
+		int insert(const clusterCode& code);
+
+		// Retrieves the index of the cluster with the given code, or -1 if it is not occupied:
+		int find(const clusterCode& code);
+
+		// Retrieves the code of the cluster at index:
+		clusterCode getCode(int index);
+
+		// Retrieves the number of occupied clusters:
+		int getSize();
+
+		// Destructor:
+        ~ClusterTable();
+    protected:
+
+		// Doubles the number of slots and reinserts every cluster:
+		void grow();
+
+    private:
+
+		vector<int> m_slots;			// m_slots of s holds the index of the cluster in slot s, or -1 if empty
+		vector<clusterCode> m_codes;	// m_codes of i holds the code of the cluster at index i
+		unsigned long long m_mask;		// Number of slots minus one
+};
+
+#endif // CLUSTERTABLE_H
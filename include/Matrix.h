@@ -3,14 +3,39 @@
 
 #include "global.h"			// General configuration file
 #include "Bitmask.h"		// Array class for storing bits
-
-typedef double data_t;
+#include "MatrixView.h"		// Storage view with layout fixed at compile time
+#include "ClusterTable.h"	// Map of occupied clusters
+#include "ClusterHistogram.h"	// Clusters occupied by a slice of registers
+
+#include <fstream>
+
+#define BINARY_MAGIC "BINCLUST"		// First bytes of a dataset file in binary columnar format
+#define BINARY_VERSION 1			// Version of the binary columnar format
+#define PARSE_MIN_CHUNK (1 << 20)	// Minimum bytes of a text file handed to each parsing thread
+#define MATRIX_ALIGNMENT 64			// Alignment in bytes of the storage buffer and of each stored column
+
+// Header of the binary columnar format. It is followed by one block of m_rows data_t values
+// per dimension, signal registers first and background registers right after:
+typedef struct {
+	char magic[8];					// Holds BINARY_MAGIC without the terminating null
+	int version;					// Holds BINARY_VERSION
+	int elementSize;				// Size in bytes of data_t when the file was written (4 for float, 8 for double)
+	long long signalSize;			// Total elements of class 0
+	long long backgroundSize;		// Total elements of class 1
+	long long dims;					// Total dimensions
+	char padding[24];				// Pads header to 64 bytes, keeping columns aligned
+} binaryHeader;
+
+// Counts the registers (non-empty lines not starting with '#') in [begin, end) and saves it in count:
+void countTextRegisters(const char* begin, const char* end, int* count);
 
 class Matrix {
     public:
-		// Constructor, requires a fileLocation (path to file where data is stored in text format).
-		// Variable columnsSeq, if set, inverts storage format for columns and rows:
-        Matrix(const char* fileLocation, bool columnsSeq=false);
+		// Constructor, requires a fileLocation (path to file where data is stored in text or binary format).
+		// Variable columnsSeq, if set, inverts storage format for columns and rows. Binary files loaded
+		// with columnsSeq set are memory-mapped and used in place. Text files are parsed by at most
+		// numThreads threads, where 0 means every CPU available to the process:
+        Matrix(const char* fileLocation, bool columnsSeq=false, int numThreads=0);
 
 		// Constructor, takes a N x D parameter and allocates space:
 		Matrix(int rows, int columns, bool columnsSeq=false);
@@ -21,6 +46,31 @@ class Matrix {
         // Saves a value in the matrix:
         data_t put(int i, int j, data_t value);
 
+		// Retrieves a pointer to the first element of column j. Element i of the column is at i*getColumnStep():
+		data_t* getColumn(int j);
+
+		// Retrieves the distance between consecutive elements of a column (1 if columns are stored sequentially):
+		long long getColumnStep();
+
+		// Retrieves a pointer to the first element of row i. Element j of the row is at j*getRowStep():
+		data_t* getRow(int i);
+
+		// Retrieves the distance between consecutive elements of a row (1 if rows are stored sequentially):
+		long long getRowStep();
+
+		// Retrieves if columns are stored sequentially:
+		bool isColumnsSeq();
+
+		// Retrieves a view of the storage with the layout resolved at compile time, so accessors inline
+		// into hot loops. columnsSeq must match isColumnsSeq():
+		template <bool columnsSeq> MatrixView<columnsSeq> getView(){
+			return MatrixView<columnsSeq>(m_matrix, m_stride, m_rows, m_columns);
+		}
+
+		// Retrieves if the matrix holds data. Matrices read from a file that is missing or invalid don't,
+		// and only say why on the output:
+		bool isLoaded();
+
 		// Retrieves number of rows:
 		int getRows();
 
@@ -30,11 +80,27 @@ class Matrix {
 		// Retrieves class of data:
 		int getClassOf(int i);
 
-		// Retrieves cluster of data:
+		// Retrieves cluster of data, as an index in [0, getTotalClusters()):
 		int getClusterOf(int i);
 
-		// Saves cluster of data:
-		void putClusterOf(int i, int cluster);
+		// Saves cluster of data given its code, occupying the cluster if it was empty. Not thread-safe,
+		// parallel passes count into a ClusterHistogram per thread and merge it instead:
+		void putClusterOf(int i, const clusterCode& code);
+
+		// Saves cluster index of data without touching per-cluster information. Safe to call from
+		// several threads as long as each works on its own registers:
+		void putClusterIndexOf(int i, int cluster);
+
+		// Occupies the clusters counted in histogram and adds its counts to theirs. Retrieves, for each
+		// local index of histogram, the index of its cluster in this matrix. Histograms must be merged
+		// one at a time, in the order of their slices:
+		vector<int> mergeHistogram(ClusterHistogram* histogram);
+
+		// Retrieves the code of a cluster:
+		clusterCode getClusterCode(int cluster);
+
+		// Retrieves total number of occupied clusters:
+		int getTotalClusters();
 
 		// Signals that cluster has size signal registers:
 		void putSignalDist(int cluster, int size);
@@ -72,6 +138,13 @@ class Matrix {
 		// Saves the distribution of registers in each cluster into a file at *location*:
         void saveClusterDist();
 
+		// Writes this matrix in the binary columnar format to fileLocation. Retrieves false if it couldn't:
+		bool saveBinary(const char* fileLocation);
+
+		// Converts a dataset in text format at textLocation into the binary columnar format at binaryLocation.
+		// Retrieves false if the text file couldn't be read or the binary one written:
+		static bool convertToBinary(const char* textLocation, const char* binaryLocation);
+
 		// Destructor:
         ~Matrix();
 
@@ -81,20 +154,44 @@ class Matrix {
 		// allocates space for m_class, m_cluster, m_signalDist, m_backgroundDist:
 		void allocateSpace(bool extraArrays);
 
+		// Allocates space for m_class, m_cluster and m_clusters:
+		void allocateExtraArrays();
+
+		// Reads a dataset in text format (three header lines followed by one register per line).
+		// Registers are parsed in parallel from byte ranges of the mapped file:
+		void readTextFile(std::ifstream& myFile, const char* fileLocation, int numThreads);
+
+		// Parses the registers in [begin, end) into consecutive rows starting at firstRow:
+		void parseTextChunk(const char* begin, const char* end, int firstRow);
+
+		// Maps a dataset in binary columnar format into memory. Columns are used in place when
+		// columnsSeq is set and the file has the precision of data_t, otherwise they are copied:
+		void mapBinaryFile(const char* fileLocation);
+
+		// Copies every column of a binary file, stored one after the other with m_rows values each, into
+		// storage, converting values of another precision to data_t:
+		template <class T>
+		void copyColumns(const T* columns);
+
     private:
-        data_t** m_matrix;				// Matrix to hold registers
+        data_t* m_matrix;				// Single buffer holding every register, line after line
+		long long m_stride;				// Distance between the starts of consecutive lines (rows, or columns if m_inverted)
 		Bitmask* m_class;				// m_class of i returns the class register i-1 belongs to
-		Bitmask* m_contamination;		// m_contamination of i returns the class that contamines cluster i the most
-		Bitmask* m_hasBothClasses;		// m_hasBothClasses of i returns true if cluster i contains at least one register of each class
+		ClusterTable* m_clusters;		// Maps codes of occupied clusters to cluster indices
+		vector<char> m_contamination;	// m_contamination of i returns the class that contamines cluster i the most
+		vector<char> m_hasBothClasses;	// m_hasBothClasses of i returns true if cluster i contains at least one register of each class
 		int* m_cluster;					// m_cluster of i returns the cluster register i belongs to
-		int* m_signalDist;				// m_signalDist of i returns the number of signal registers present in cluster i / m_signalSize
-		int* m_backgroundDist;			// m_backgroundDist of i returns the number of background registers present in cluster i / m_backgroundSize
+		vector<int> m_signalDist;		// m_signalDist of i returns the number of signal registers present in cluster i / m_signalSize
+		vector<int> m_backgroundDist;	// m_backgroundDist of i returns the number of background registers present in cluster i / m_backgroundSize
         int m_rows;						// Total number of registers
 		int m_columns;					// Total dimensions
 		int m_signalSize;				// Total elements of class 0
 		int m_backgroundSize;			// Total elements of class 1
 		bool m_inverted;				// If set, columns will be stored sequentially
 		bool m_extraArrays;				// Signals whether this matrix holds space for the extra arrays (cluster, contamination, etc)
+		bool m_loaded;					// Signals whether the matrix holds data (its file was read successfully)
+		void* m_mapping;				// Start of the mapped binary file, or NULL if data is not mapped
+		long long m_mappingSize;		// Size in bytes of the mapped binary file
 };
 
 #endif // MATRIX_H
@@ -0,0 +1,69 @@
+#ifndef MATRIXVIEW_H
+#define MATRIXVIEW_H
+
+#include "global.h"			// General configuration file
+
+// Non-owning view over contiguous matrix storage, with the layout fixed at compile time.
+// If columnsSeq is set, columns are stored sequentially (element (i,j) lives at j*stride + i),
+// otherwise rows are (element (i,j) lives at i*stride + j). Accessors are defined here so they
+// inline into the loops that use them:
+template <bool columnsSeq, class T = data_t> class MatrixView {
+    public:
+		// Constructor, takes the first element of the storage, the distance between lines and a N x D size:
+		MatrixView(T* data, long long stride, int rows, int columns)
+			: m_data(data), m_stride(stride), m_rows(rows), m_columns(columns) {}
+
+        // Retrieves a value in the matrix:
+        inline T get(int i, int j) const {
+			return m_data[offset(i, j)];
+		}
+
+        // Saves a value in the matrix:
+        inline void put(int i, int j, T value){
+			m_data[offset(i, j)] = value;
+		}
+
+		// Retrieves a pointer to the first element of column j. Element i of the column is at i*getColumnStep():
+		inline T* getColumn(int j) const {
+			return m_data + offset(0, j);
+		}
+
+		// Retrieves the distance between consecutive elements of a column:
+		inline long long getColumnStep() const {
+			return (columnsSeq) ? 1 : m_stride;
+		}
+
+		// Retrieves a pointer to the first element of row i. Element j of the row is at j*getRowStep():
+		inline T* getRow(int i) const {
+			return m_data + offset(i, 0);
+		}
+
+		// Retrieves the distance between consecutive elements of a row:
+		inline long long getRowStep() const {
+			return (columnsSeq) ? m_stride : 1;
+		}
+
+		// Retrieves number of rows:
+		inline int getRows() const {
+			return m_rows;
+		}
+
+		// Retrieves number of columns:
+		inline int getDims() const {
+			return m_columns;
+		}
+
+    private:
+
+		// Calculates the position of element (i,j) in the storage:
+		inline long long offset(int i, int j) const {
+			return (columnsSeq) ? j*m_stride + i : i*m_stride + j;
+		}
+
+		T* m_data;						// First element of the storage
+		long long m_stride;				// Distance between the starts of consecutive lines
+		int m_rows;						// Total number of registers
+		int m_columns;					// Total dimensions
+};
+
+#endif // MATRIXVIEW_H
@@ -3,16 +3,21 @@
 
 #include <vector>
 #include "Matrix.h"
+#include "ThreadPool.h"		// Threads training the parts of a cascade
 #include "svm.h"
-#include "SharedVector.h"
 
 
 using namespace std;
 
 class SVM_Trainer {
     public:
-		// Constructor:
-        SVM_Trainer(Matrix* matrixData, SharedVector<int>* indexes, struct svm_parameter param);
+		// Constructor, trains on the numRegisters registers of matrixData whose indices start at indexes.
+		// If pool is given and there are more than CASCADE_PART_SIZE registers, trains a cascade SVM
+		// instead: registers are split in parts trained in parallel on pool, whose support vectors are
+		// merged pairwise and retrained until one problem is left. That problem is then retrained on its
+		// support vectors plus every register violating its margin, until none does; if some still do after
+		// CASCADE_MAX_PASSES passes, every register is trained at once instead. pool must not be running a job:
+        SVM_Trainer(Matrix* matrixData, const int* indexes, int numRegisters, struct svm_parameter param, ThreadPool* pool=NULL);
 
 		// Returns the total number of support vectors:
 		int getTotalSV();
@@ -24,20 +29,36 @@ class SVM_Trainer {
         ~SVM_Trainer();
     protected:
 
-		// Function to transform data into the format used by the SVM program:
-		vector<vector<data_t>> generateData(Matrix* data);
+		// Trains on the numRegisters registers of data whose indices start at indexes, keeping the model:
+		void train(Matrix* data, const int* indexes, int numRegisters, struct svm_parameter param);
 
-		// Function to transform labels into the format used by the SVM program:
-		vector<int> generateLabels(Matrix* data);
+		// Trains as a cascade on pool, leaving the model of the last problem of the cascade:
+		void trainCascade(Matrix* data, const int* indexes, int numRegisters, struct svm_parameter param, ThreadPool* pool);
+
+		// Retrieves the registers among the numRegisters whose indices start at indexes that are not support
+		// vectors of the model but lie inside its margin, i.e. would change it if trained on, sorted:
+		vector<int> findViolators(Matrix* data, const int* indexes, int numRegisters, struct svm_parameter param, ThreadPool* pool);
+
+		// Frees the model and the problem it was trained on:
+		void release();
+
+		// Fills labels and nodes of m_prob straight from the registers of the data matrix, optionally
+		// subtracting their mean:
+		void fillProblem(Matrix* data, bool center);
 
     private:
 
 		int m_numRegisters; 			// Total number of registers
 		int m_numDimensions;			// Total number of dimensions
-		SharedVector<int>* m_indexes;	// Real indices of data, in relation to data matrix
+		const int* m_indexes;			// Real indices of data, in relation to data matrix
+		vector<int> m_cascade;			// Registers of the last problem of a cascade, m_indexes points here
+		vector<double> m_mean;			// Mean subtracted from every attribute of the problem
 		struct svm_problem m_prob;
 		struct svm_model* m_model;
 		struct svm_node* m_Xspace;
+#ifdef _DENSE_REP
+		double* m_values;				// Gathered values of dense nodes, NULL if rows are used in place
+#endif
 };
 
 #endif // SVMTRAINER_H
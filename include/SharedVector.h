@@ -8,18 +8,50 @@ using namespace std;
 
 template <class T> class SharedVector {
     public:
+		// Iterates through every element as if the vectors were a continous space:
+		class iterator {
+			public:
+				iterator(SharedVector<T>* owner, int vec, int pos) : m_owner(owner), m_vec(vec), m_pos(pos) { skipEmpty(); }
+				T& operator*() { return m_owner->m_vector[m_vec][m_pos]; }
+				iterator& operator++() { m_pos++; skipEmpty(); return *this; }
+				bool operator!=(const iterator& other) const { return (m_vec != other.m_vec) || (m_pos != other.m_pos); }
+			private:
+				// Moves past the end of exhausted vectors:
+				void skipEmpty() {
+					while ((m_vec < m_owner->m_numThreads) && (m_pos == (int) m_owner->m_vector[m_vec].size())){
+						m_vec++;
+						m_pos = 0;
+					}
+				}
+				SharedVector<T>* m_owner;	// Shared vector being iterated
+				int m_vec;					// Vector of the current element
+				int m_pos;					// Position of the current element inside its vector
+		};
+
 		// Constructor:
         SharedVector(int numThreads);
 
-		// Retrieves the index-th value as if the vectors were a continous space:
+		// Retrieves the index-th value as if the vectors were a continous space, by binary search over the
+		// numThreads+1 offsets built by finalize. Requires finalize after the last push:
 		T get(int index);
 
 		// Adds value to the vector owned by thread threadId:
 		void push(T value, int threadId);
 
-		// Returns total number of elements across all vectors:
+		// Returns total number of elements across all vectors, adding up the size of each one:
 		int getSize();
 
+		// Builds the offsets read by get. The owner calls it once after the last push and before any
+		// reader starts, so several threads can read at the same time:
+		void finalize();
+
+		// Returns a single contiguous copy of every element, in index order:
+		vector<T> flatten();
+
+		// Retrieves iterators to the first element and past the last one, for range loops:
+		iterator begin();
+		iterator end();
+
 		// Destructor:
         ~SharedVector();
     protected:
@@ -27,9 +59,9 @@ template <class T> class SharedVector {
     private:
 
 		vector<vector<T>> m_vector;		// Internal shared vector
+		vector<int> m_offsets;			// m_offsets of t holds the index of the first element of thread t, m_offsets of numThreads holds the size
 		int m_numThreads;				// Total number of threads
-		int m_size;						// Sum of size of vectors as if they were a huge vector
-		bool m_sizeHasChanged;			// True if an element has been added to the size since last calculation
+		bool m_finalized;				// True if no element has been pushed since the offsets were built
 };
 
 #endif // SHAREDVECTOR_H
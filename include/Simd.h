@@ -0,0 +1,34 @@
+#ifndef SIMD_H
+#define SIMD_H
+
+#include "global.h"			// General configuration file
+
+// Helpers shared by the SIMD kernels. Each kernel is compiled for its instruction set with a target
+// attribute and selected at runtime, so only x86 builds see the intrinsics:
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>		// For SIMD intrinsics
+#define SIMD_X86
+
+// Loads four values as doubles (converting floats is exact):
+__attribute__((target("avx2")))
+static inline __m256d load4(const double* x){
+	return _mm256_loadu_pd(x);
+}
+__attribute__((target("avx2")))
+static inline __m256d load4(const float* x){
+	return _mm256_cvtps_pd(_mm_loadu_ps(x));
+}
+
+// Loads eight values as doubles:
+__attribute__((target("avx512f")))
+static inline __m512d load8(const double* x){
+	return _mm512_loadu_pd(x);
+}
+__attribute__((target("avx512f")))
+static inline __m512d load8(const float* x){
+	return _mm512_cvtps_pd(_mm256_loadu_ps(x));
+}
+
+#endif
+
+#endif // SIMD_H
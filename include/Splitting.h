@@ -0,0 +1,17 @@
+#ifndef SPLITTING_H
+#define SPLITTING_H
+
+#include "global.h"			// General configuration file
+
+#define SPLIT_BLOCK 1024			// Registers whose cluster codes are built together, one column at a time
+
+// Adds bin << shift to codes[i] for count values spaced step apart, where bin is the number of the
+// numLimits ascending limits that are less than or equal to the value (i.e. the index of the first
+// limit the value is to the left of). Uses the widest SIMD unit available at runtime (AVX-512, AVX2
+// or scalar). count must not exceed SPLIT_BLOCK:
+void assignBins(const data_t* values, long long step, int count, const data_t* limits, int numLimits, int shift, unsigned long long* codes);
+
+// Retrieves the name of the kernel selected for this CPU:
+const char* assignBinsKernel();
+
+#endif // SPLITTING_H
@@ -0,0 +1,26 @@
+#ifndef STATISTICS_H
+#define STATISTICS_H
+
+#include "global.h"			// General configuration file
+
+#define STATS_BLOCK 2048			// Values per block: each block is read from memory once and reused from L1
+
+// Summary of a set of values, enough to obtain mean and stddev and to merge disjoint sets:
+typedef struct {
+	long long count;				// Total number of values
+	double mean;					// Mean of the values
+	double m2;						// Sum of squared deviations from the mean
+} columnStats;
+
+// Calculates statistics of count values spaced step apart in a single pass over memory. Values are
+// processed in blocks of STATS_BLOCK using the widest SIMD unit available at runtime (AVX-512, AVX2
+// or scalar), and blocks are merged with mergeColumnStats:
+columnStats computeColumnStats(const data_t* values, long long step, long long count);
+
+// Merges statistics of two disjoint sets of values (Chan et al., 1979):
+columnStats mergeColumnStats(columnStats a, columnStats b);
+
+// Retrieves the name of the kernel selected for this CPU:
+const char* columnStatsKernel();
+
+#endif // STATISTICS_H
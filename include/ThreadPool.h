@@ -0,0 +1,65 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+using namespace std;
+
+// How parallelFor hands out the index range:
+typedef enum {
+	SCHEDULE_STATIC,		// One contiguous slice per thread, thread t always getting the t-th slice
+	SCHEDULE_DYNAMIC,		// Chunks of fixed size, claimed by threads as they become free
+	SCHEDULE_GUIDED			// Chunks claimed as threads become free, shrinking from remaining/(2*threads) down to a minimum
+} schedule_t;
+
+// Fixed set of threads kept alive across jobs, so each stage of the pipeline only pays for waking them
+// up. The calling thread works as thread 0, so a pool of n threads starts n-1 of its own:
+class ThreadPool {
+    public:
+		// Constructor, starts numThreads-1 worker threads:
+        ThreadPool(int numThreads);
+
+		// Retrieves total number of threads, counting the calling one:
+		int getNumThreads();
+
+		// Retrieves how many threads this process can run at once: CPUs in its affinity mask, further
+		// limited by the CPU quota of its cgroup when one is set:
+		static int availableThreads();
+
+		// Runs job(threadId) once on each of the first numThreads threads (every thread if 0) and waits until
+		// all are done. The other threads are not waited for:
+		void run(const function<void(int threadId)>& job, int numThreads=0);
+
+		// Runs body(start, end, threadId) over chunks covering [begin, end) and waits until all are done.
+		// With SCHEDULE_STATIC every thread gets its slice, even if empty, so per-thread results can be
+		// indexed by threadId and merged in order. chunk is the chunk size of SCHEDULE_DYNAMIC and the
+		// minimum chunk size of SCHEDULE_GUIDED:
+		void parallelFor(int begin, int end, const function<void(int start, int end, int threadId)>& body,
+						 schedule_t schedule=SCHEDULE_STATIC, int chunk=1);
+
+		// Destructor, stops and joins worker threads:
+        ~ThreadPool();
+    protected:
+
+		// Loop run by each worker thread, waiting for jobs until the pool stops:
+		void workerLoop(int threadId);
+
+    private:
+
+		int m_numThreads;						// Total number of threads, counting the calling one
+		vector<thread> m_workers;				// Worker threads (threadIds 1 to m_numThreads-1)
+		mutex m_mutex;							// Guards every member below
+		condition_variable m_wake;				// Signals workers that a job was posted or the pool stopped
+		condition_variable m_done;				// Signals the calling thread that workers finished the job
+		const function<void(int)>* m_job;		// Job being run
+		int m_active;							// Threads running the current job (threadIds 0 to m_active-1)
+		long long m_generation;					// Number of jobs posted so far
+		int m_pending;							// Workers still running the current job
+		bool m_stop;							// Tells workers to return
+};
+
+#endif // THREADPOOL_H
@@ -1,8 +1,24 @@
+// Type of stored values. Building with -DSINGLE_PRECISION halves the memory and bandwidth of the data
+// matrix, while statistics are still accumulated in double:
+#ifdef SINGLE_PRECISION
+typedef float data_t;
+#else
 typedef double data_t;
+#endif
 
 #define K 3							// Number of divisions
-#define CORES 1 					// Number of CPUs
+#define THREADS_ENV "CLUSTERING_THREADS"	// Environment variable with the number of threads, used when --threads is not given
+#define MAX_THREADS 4096			// Largest number of threads accepted
 #define WARP 2            			// Multiplier to stddev when dividing space
 #define PERC_MIN 0.15				// Minimum percentage in the interval [0, 1] of data to grab from a cluster
 #define PERC_MULT 1.0				// Multiplier in the interval [0, 2] for how much a cluster will yield, where 1 is default
 #define TAKE_AT_LEAST 1				// Minimum number of regisers to take from each cluster
+#define CENTROID_MIN_ROWS 4096		// Minimum rows per thread for centroids to be split by rows instead of columns (two STATS_BLOCKs, so merging partials stays negligible)
+#define CODE_WORDS 2				// 64-bit words in a cluster code, enough for 64/ceil(log2 K) dimensions each
+#define SVM_PARALLEL_MIN_CLUSTER 50000	// Clusters with at least this many registers are trained one at a time, using every thread inside the solver
+#define SVM_PARALLEL_MIN_LEN 16384	// Fewest elements of a kernel column fill or gradient update given to each thread it is split across
+#define CASCADE_MIN_CLUSTER 200000	// Clusters with at least this many registers are trained as a cascade SVM
+#define CASCADE_PART_SIZE 25000		// Most registers in each first-layer problem of a cascade
+#define CASCADE_MAX_PASSES 4		// Feedback passes of a cascade before it trains every register at once, if some still violate its margin
+#define CASCADE_MAX_FRACTION 0.5	// Cascades whose last problem holds more of the registers than this train them all at once instead
+#define PICK_MIN_CHUNK 16			// Fewest clusters a thread claims at once when picking registers
@@ -9,11 +9,24 @@ extern "C" {
 
 extern int libsvm_version;
 
+/* Dense vectors: each training vector is a single svm_node holding dim contiguous values, values[k]
+   being feature k+1. Undefine to go back to sparse vectors of index/value pairs ended by index -1.
+   The PRECOMPUTED kernel needs the sparse representation. */
+#define _DENSE_REP
+
+#ifdef _DENSE_REP
+struct svm_node
+{
+	int dim;
+	double *values;
+};
+#else
 struct svm_node
 {
 	int index;
 	double value;
 };
+#endif
 
 struct svm_problem
 {
@@ -25,6 +38,16 @@ struct svm_problem
 enum { C_SVC, NU_SVC, ONE_CLASS, EPSILON_SVR, NU_SVR };	/* svm_type */
 enum { LINEAR, POLY, RBF, SIGMOID, PRECOMPUTED }; /* kernel_type */
 
+/* Runs body(start,end,arg) over disjoint chunks covering [begin,end) on threads owned by the caller
+   and returns once all are done, so a single solve can fill kernel columns and update the gradient
+   on several threads. */
+struct svm_parallel
+{
+	void (*parallel_for)(void *pool, int begin, int end, void (*body)(int start, int end, void *arg), void *arg);
+	void *pool;	/* passed back to parallel_for */
+	int min_len;	/* loops shorter than twice this run on the calling thread */
+};
+
 struct svm_parameter
 {
 	int svm_type;
@@ -44,6 +67,8 @@ struct svm_parameter
 	double p;	/* for EPSILON_SVR */
 	int shrinking;	/* use the shrinking heuristics */
 	int probability; /* do probability estimates */
+	int linear_solver; /* for C_SVC with LINEAR kernel: 1 trains the bias-regularized (LIBLINEAR) problem with dual coordinate descent instead of SMO */
+	struct svm_parallel *parallel; /* threads for kernel columns and gradient updates, NULL for none */
 };
 
 //
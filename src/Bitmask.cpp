@@ -1,28 +1,64 @@
 #include "Bitmask.h"
 #include <iostream>
 #include <fstream>
-#include <math.h>
+#include <cstring>
 
 using namespace std;
 
+
+// Counts TRUE bits of n words, using the generic builtin:
+static int countScalar(const unsigned long long* words, int n){
+	int acc = 0;
+	for (int w = 0; w < n; w++){
+		acc += __builtin_popcountll(words[w]);
+	}
+	return acc;
+}
+
+
+#if defined(__x86_64__) || defined(__i386__)
+
+// Counts TRUE bits of n words, using the hardware popcount instruction:
+__attribute__((target("popcnt")))
+static int countPOPCNT(const unsigned long long* words, int n){
+	int acc = 0;
+	for (int w = 0; w < n; w++){
+		acc += __builtin_popcountll(words[w]);
+	}
+	return acc;
+}
+
+#endif
+
+
+// Counting routine, selected once for this CPU:
+typedef int (*countKernel)(const unsigned long long*, int);
+static countKernel selectCountKernel(){
+#if defined(__x86_64__) || defined(__i386__)
+	if (__builtin_cpu_supports("popcnt")){
+		return countPOPCNT;
+	}
+#endif
+	return countScalar;
+}
+static const countKernel countBits = selectCountKernel();
+
+
 // Constructor:
 Bitmask::Bitmask(int length, bool setTrue){
     // Saves total length of bitmask:
     bitmaskLength = length;
     // Allocates memory space:
-    vArray = new bitset<B_SIZE>[(int)ceil(bitmaskLength/B_SIZE)+B_SIZE];
+    totalWords = (bitmaskLength + B_SIZE - 1) / B_SIZE;
+    vArray = new unsigned long long[totalWords];
     // Fills in all elements with starting value:
-    for (int i=1; i<=bitmaskLength; i++){
-        this->put(i, setTrue);
-    }
+    this->reset(setTrue);
 }
 
 
 // Returns the boolean value of the i-th element:
 bool Bitmask::get(int i){
-    int byteNum = floor((float)(i-1.0)/B_SIZE);
-    int bitNum = (i-1) % B_SIZE;
-    return (bool) vArray[byteNum][bitNum];
+    return (vArray[(i-1) / B_SIZE] >> ((i-1) % B_SIZE)) & 1;
 }
 
 
@@ -34,26 +70,37 @@ void Bitmask::put(int i, bool value){
         return;
     }
     // Puts value in the i-th position:
-    int byteNum = floor((float)(i-1.0)/B_SIZE);
-    int bitNum = (i-1) % B_SIZE;
-    vArray[byteNum][bitNum] = value;
-
+    unsigned long long bit = 1ULL << ((i-1) % B_SIZE);
+    if (value == true){
+        vArray[(i-1) / B_SIZE] |= bit;
+    } else {
+        vArray[(i-1) / B_SIZE] &= ~bit;
+    }
 }
 
 
 
-// Returns the number of TRUE elements in O(n):
-int Bitmask::getSize(){
-    // Accumulator variable:
-    int acc = 0;
-    // Loops through the bitmask:
-    for (int i=1; i<=bitmaskLength; i++){
-        if (this->get(i) == true){
-            acc += 1;
-        }
+// Puts value in the i-th position with an atomic read-modify-write on its word:
+void Bitmask::putAtomic(int i, bool value){
+	// Returns immediately in case position i is outside allocated boundaries:
+    if ((i<1) || (i>bitmaskLength)){
+        cout << "ERRO: Acesso a indice indefinido no Bitmask (indice " << i << ", fora dos limites 1 a " << bitmaskLength << ")" << endl;
+        return;
+    }
+    // Puts value in the i-th position. Ordering is relaxed, since readers only look at the
+    // bitmask after joining the writing threads:
+    unsigned long long bit = 1ULL << ((i-1) % B_SIZE);
+    if (value == true){
+        __atomic_fetch_or(&vArray[(i-1) / B_SIZE], bit, __ATOMIC_RELAXED);
+    } else {
+        __atomic_fetch_and(&vArray[(i-1) / B_SIZE], ~bit, __ATOMIC_RELAXED);
     }
-    // Returns sum of true elements:
-    return acc;
+}
+
+
+// Returns the number of TRUE elements, counting a word at a time:
+int Bitmask::getSize(){
+    return countBits(vArray, totalWords);
 }
 
 
@@ -82,12 +129,12 @@ void Bitmask::print(){
 // Transfers the value of setTrue to every position in the bitmask:
 void Bitmask::reset(bool setTrue){
     if (setTrue == false){
-        for (int i=1; i<=bitmaskLength; i++){
-            this->put(i, false);
-        }
+        memset(vArray, 0, totalWords * sizeof(unsigned long long));
     } else {
-        for (int i=1; i<=bitmaskLength; i++){
-            this->put(i, true);
+        memset(vArray, 0xFF, totalWords * sizeof(unsigned long long));
+        // Keeps bits past the length cleared:
+        if (bitmaskLength % B_SIZE != 0){
+            vArray[totalWords-1] = (1ULL << (bitmaskLength % B_SIZE)) - 1;
         }
     }
 }
@@ -97,16 +144,61 @@ void Bitmask::reset(bool setTrue){
 bool Bitmask::equals(Bitmask* R){
     if (this->getLength() != R->getLength()){
         return false;
-    } else if (this->getSize() != R->getSize()){
-        return false;
     } else {
-        for (int i=1; i<=bitmaskLength; i++){
-            if (this->get(i) != R->get(i)){
-                return false;
-            }
-        }
-        return true;
+        return memcmp(vArray, R->vArray, totalWords * sizeof(unsigned long long)) == 0;
+    }
+}
+
+
+// Checks if bitmask R has the same length as this one:
+bool Bitmask::sameLength(Bitmask* R){
+    if (this->getLength() != R->getLength()){
+        cout << "ERRO: Bitmasks de tamanhos diferentes (" << bitmaskLength << " e " << R->getLength() << ")" << endl;
+        return false;
+    }
+    return true;
+}
+
+
+// Keeps TRUE only the elements that are also TRUE in bitmask R:
+void Bitmask::andWith(Bitmask* R){
+    if (this->sameLength(R) == false) return;
+    for (int w = 0; w < totalWords; w++){
+        vArray[w] &= R->vArray[w];
+    }
+}
+
+
+// Sets TRUE every element that is TRUE in bitmask R:
+void Bitmask::orWith(Bitmask* R){
+    if (this->sameLength(R) == false) return;
+    for (int w = 0; w < totalWords; w++){
+        vArray[w] |= R->vArray[w];
+    }
+}
+
+
+// Sets FALSE every element that is TRUE in bitmask R:
+void Bitmask::andNotWith(Bitmask* R){
+    if (this->sameLength(R) == false) return;
+    for (int w = 0; w < totalWords; w++){
+        vArray[w] &= ~R->vArray[w];
+    }
+}
+
+
+// Returns the first position after i holding TRUE, or 0 if there is none:
+int Bitmask::nextSet(int i){
+    // Position i+1 lives at bit i:
+    if (i >= bitmaskLength) return 0;
+    int w = i / B_SIZE;
+    // Ignores bits up to position i in the first word:
+    unsigned long long word = vArray[w] & (~0ULL << (i % B_SIZE));
+    while (word == 0){
+        if (++w == totalWords) return 0;
+        word = vArray[w];
     }
+    return w*B_SIZE + __builtin_ctzll(word) + 1;
 }
 
 
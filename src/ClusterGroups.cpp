@@ -0,0 +1,130 @@
+#include "ClusterGroups.h"
+#include <cmath>			// For rounding slices
+
+using namespace std;
+
+// Constructor, groups the registers of matrix by the cluster they were assigned to:
+ClusterGroups::ClusterGroups(Matrix* matrix, ThreadPool* pool){
+
+	m_matrix = matrix;
+	m_totalClusters = matrix->getTotalClusters();
+	int rows = matrix->getRows();
+
+	// One slice of rows per thread, limited so that histograms grow with registers, not with threads times clusters:
+	long long maxSlices = (GROUP_HISTOGRAM_RATIO * (long long) rows) / max(1, m_totalClusters);
+	m_numSlices = max(1, (int) min((long long) pool->getNumThreads(), maxSlices));
+
+
+	/////////////////////////
+	/// COUNTS EACH SLICE ///
+	/////////////////////////
+
+	// One histogram per slice, filled with counts first and positions later:
+	m_positions.assign((long long) m_numSlices * m_totalClusters, 0);
+
+	// Threads count their slices:
+	pool->parallelFor(0, m_numSlices, [this](int start, int end, int /*threadId*/){
+		for (int slice = start; slice < end; slice++){
+			this->countSlice(slice);
+		}
+	}, SCHEDULE_DYNAMIC);
+
+
+	///////////////////
+	/// PREFIX SUMS ///
+	///////////////////
+
+	// Clusters are laid out one after the other, and inside a cluster each slice's registers follow
+	// those of previous slices, so members end up in increasing register order:
+	m_offsets.assign(m_totalClusters + 1, 0);
+	int acc = 0;
+	for (int c = 0; c < m_totalClusters; c++){
+		m_offsets[c] = acc;
+		for (int slice = 0; slice < m_numSlices; slice++){
+			int count = m_positions[(long long) slice * m_totalClusters + c];
+			m_positions[(long long) slice * m_totalClusters + c] = acc;
+			acc += count;
+		}
+	}
+	m_offsets[m_totalClusters] = acc;
+
+
+	///////////////////////////
+	/// SCATTERS EACH SLICE ///
+	///////////////////////////
+
+	m_members.resize(acc);
+
+	// Threads write their slices:
+	pool->parallelFor(0, m_numSlices, [this](int start, int end, int /*threadId*/){
+		for (int slice = start; slice < end; slice++){
+			this->scatterSlice(slice);
+		}
+	}, SCHEDULE_DYNAMIC);
+
+	// Positions are no longer needed:
+	vector<int>().swap(m_positions);
+}
+
+
+// Job to count how many registers of each cluster lie in a slice of rows:
+void ClusterGroups::countSlice(int slice){
+
+    // Number of lines to check:
+	double each = (m_matrix->getRows())*1.0 / m_numSlices;
+
+    // Calculates chunck:
+    int start = round(slice*each);
+    int end = round((slice+1)*each);
+
+	// Histogram of this slice:
+	int* counts = &m_positions[(long long) slice * m_totalClusters];
+
+    // Loops through designated lines:
+	for (int i = start; i < end; i++){
+		counts[m_matrix->getClusterOf(i)]++;
+	}
+}
+
+
+// Job to write the registers of a slice of rows into their clusters:
+void ClusterGroups::scatterSlice(int slice){
+
+    // Number of lines to write:
+	double each = (m_matrix->getRows())*1.0 / m_numSlices;
+
+    // Calculates chunck:
+    int start = round(slice*each);
+    int end = round((slice+1)*each);
+
+	// Next position of each cluster for this slice:
+	int* positions = &m_positions[(long long) slice * m_totalClusters];
+
+    // Loops through designated lines:
+	for (int i = start; i < end; i++){
+		m_members[positions[m_matrix->getClusterOf(i)]++] = i;
+	}
+}
+
+
+// Retrieves the number of registers in a cluster:
+int ClusterGroups::getSize(int cluster){
+	return m_offsets[cluster+1] - m_offsets[cluster];
+}
+
+
+// Retrieves a pointer to the first register of a cluster:
+const int* ClusterGroups::getMembers(int cluster){
+	return m_members.data() + m_offsets[cluster];
+}
+
+
+// Retrieves total number of clusters:
+int ClusterGroups::getTotalClusters(){
+	return m_totalClusters;
+}
+
+
+// Destructor:
+ClusterGroups::~ClusterGroups(){
+}
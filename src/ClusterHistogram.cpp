@@ -0,0 +1,55 @@
+#include "ClusterHistogram.h"
+
+using namespace std;
+
+// Constructor:
+ClusterHistogram::ClusterHistogram(){
+}
+
+
+// Counts a register of class classOf in the cluster with the given code:
+int ClusterHistogram::add(const clusterCode& code, int classOf){
+	// Finds local index of the cluster:
+	int cluster = m_table.insert(code);
+	// Checks if cluster was just occupied by this slice:
+	if (cluster == (int) m_signalCount.size()){
+		m_signalCount.push_back(0);
+		m_backgroundCount.push_back(0);
+	}
+	// Increments the counter of the register's class:
+	if (classOf == 0){
+		m_signalCount[cluster]++;
+	} else {
+		m_backgroundCount[cluster]++;
+	}
+	return cluster;
+}
+
+
+// Retrieves the code of the cluster at local index:
+clusterCode ClusterHistogram::getCode(int index){
+	return m_table.getCode(index);
+}
+
+
+// Retrieves the number of signal registers counted in the cluster at local index:
+int ClusterHistogram::getSignalCount(int index){
+	return m_signalCount[index];
+}
+
+
+// Retrieves the number of background registers counted in the cluster at local index:
+int ClusterHistogram::getBackgroundCount(int index){
+	return m_backgroundCount[index];
+}
+
+
+// Retrieves the number of clusters occupied by this slice:
+int ClusterHistogram::getSize(){
+	return m_table.getSize();
+}
+
+
+// Destructor:
+ClusterHistogram::~ClusterHistogram(){
+}
@@ -0,0 +1,56 @@
+#include "ClusterScheduler.h"
+#include <algorithm>		// For sorting clusters
+
+using namespace std;
+
+// Constructor, queues the eligible clusters of matrix by decreasing size:
+ClusterScheduler::ClusterScheduler(Matrix* matrix, ClusterGroups* clusterGroups){
+	m_clusterGroups = clusterGroups;
+	// Keeps only clusters with at least one register of both classes:
+	for (int cluster = 0; cluster < matrix->getTotalClusters(); cluster++){
+		if (matrix->getHasBothClasses(cluster) == true){
+			m_queue.push_back(cluster);
+		}
+	}
+	// Largest clusters go first, ties in cluster order:
+	stable_sort(m_queue.begin(), m_queue.end(), [clusterGroups](int a, int b){
+		return clusterGroups->getSize(a) > clusterGroups->getSize(b);
+	});
+	m_next = 0;
+}
+
+
+// Claims the next cluster in the queue:
+bool ClusterScheduler::next(int* cluster){
+	int position = m_next.fetch_add(1, memory_order_relaxed);
+	if (position >= (int) m_queue.size()){
+		return false;
+	}
+	*cluster = m_queue[position];
+	return true;
+}
+
+
+// Claims the next cluster in the queue only if it holds at least minSize registers:
+bool ClusterScheduler::next(int minSize, int* cluster){
+	int position = m_next.load(memory_order_relaxed);
+	while ((position < (int) m_queue.size()) && (m_clusterGroups->getSize(m_queue[position]) >= minSize)){
+		// Claims it unless another thread got there first (position is then reloaded):
+		if (m_next.compare_exchange_weak(position, position + 1, memory_order_relaxed)){
+			*cluster = m_queue[position];
+			return true;
+		}
+	}
+	return false;
+}
+
+
+// Retrieves total number of queued clusters:
+int ClusterScheduler::getSize(){
+	return m_queue.size();
+}
+
+
+// Destructor:
+ClusterScheduler::~ClusterScheduler(){
+}
@@ -0,0 +1,79 @@
+#include "ClusterTable.h"
+
+using namespace std;
+
+// Constructor:
+ClusterTable::ClusterTable(){
+	// Starts with every slot empty:
+	m_slots.assign(TABLE_MIN_SLOTS, -1);
+	m_mask = TABLE_MIN_SLOTS - 1;
+}
+
+
+// Retrieves the index of the cluster with the given code, creating it if needed:
+int ClusterTable::insert(const clusterCode& code){
+	// Keeps at most half of the slots occupied, so probe sequences stay short:
+	if (2*(m_codes.size() + 1) > m_slots.size()){
+		this->grow();
+	}
+	// Probes slots starting from the hashed position:
+	unsigned long long slot = hashCode(code) & m_mask;
+	while (m_slots[slot] != -1){
+		// Checks if cluster already exists:
+		if (m_codes[m_slots[slot]] == code){
+			return m_slots[slot];
+		}
+		slot = (slot + 1) & m_mask;
+	}
+	// Occupies the empty slot with a new cluster:
+	m_slots[slot] = m_codes.size();
+	m_codes.push_back(code);
+	return m_slots[slot];
+}
+
+
+// Retrieves the index of the cluster with the given code, or -1 if it is not occupied:
+int ClusterTable::find(const clusterCode& code){
+	// Probes slots starting from the hashed position:
+	unsigned long long slot = hashCode(code) & m_mask;
+	while (m_slots[slot] != -1){
+		if (m_codes[m_slots[slot]] == code){
+			return m_slots[slot];
+		}
+		slot = (slot + 1) & m_mask;
+	}
+	// Reached an empty slot, so code is not in the table:
+	return -1;
+}
+
+
+// Retrieves the code of the cluster at index:
+clusterCode ClusterTable::getCode(int index){
+	return m_codes[index];
+}
+
+
+// Retrieves the number of occupied clusters:
+int ClusterTable::getSize(){
+	return m_codes.size();
+}
+
+
+// Doubles the number of slots and reinserts every cluster:
+void ClusterTable::grow(){
+	m_slots.assign(2*m_slots.size(), -1);
+	m_mask = m_slots.size() - 1;
+	// Reinserts clusters keeping their indices:
+	for (int i = 0; i < (int) m_codes.size(); i++){
+		unsigned long long slot = hashCode(m_codes[i]) & m_mask;
+		while (m_slots[slot] != -1){
+			slot = (slot + 1) & m_mask;
+		}
+		m_slots[slot] = i;
+	}
+}
+
+
+// Destructor:
+ClusterTable::~ClusterTable(){
+}
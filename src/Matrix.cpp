@@ -1,21 +1,48 @@
 #include <iostream>			// For basic input and output
+#include <cstdlib>			// For aligned storage allocation
 #include <fstream>
 #include <cmath>            // To calculate pow in space allocation
 #include <thread>			// To parallelize computation
 #include <random>			// For random data generation
 #include <sstream>
 #include <iomanip>			// For printing tables
+#include <cstring>			// For handling the binary header and searching for line endings
+#include <climits>			// For validating binary header sizes
+#include <charconv>			// For parsing numbers without locale overhead
+#include <vector>			// For per-thread chunk boundaries
+#include <fcntl.h>			// For opening files to be mapped
+#include <sys/mman.h>		// For mapping binary files into memory
+#include <sys/stat.h>		// For retrieving file size
+#include <unistd.h>			// For closing file descriptors
 #include "Matrix.h"
+#include "ThreadPool.h"		// For counting available CPUs
 
 using namespace std;
 
 // Allocates space for matrix:
-Matrix::Matrix(const char* fileLocation, bool columnsSeq){
+Matrix::Matrix(const char* fileLocation, bool columnsSeq, int numThreads){
+
+	// No storage or file mapping exists until the file is read:
+	m_matrix = NULL;
+	m_mapping = NULL;
+	m_mappingSize = 0;
+	m_stride = 0;
+	m_rows = 0;
+	m_columns = 0;
+	m_signalSize = 0;
+	m_backgroundSize = 0;
+	m_class = NULL;
+	m_cluster = NULL;
+	m_clusters = NULL;
+	m_extraArrays = false;
+	m_loaded = false;
+	// Saves matrix layout:
+	m_inverted = columnsSeq;
 
 	// File object:
 	ifstream myFile;
     // Opens communication with input file:
-    myFile.open(fileLocation);
+    myFile.open(fileLocation, ios::binary);
     cout << endl << "Reading file " << fileLocation << "... Please stand by." << endl;
     if (!myFile){
         // If file was not found:
@@ -23,6 +50,27 @@ Matrix::Matrix(const char* fileLocation, bool columnsSeq){
         return;
     }
 
+	// Peeks at the first bytes to find out which format the file is in:
+	char magic[sizeof(BINARY_MAGIC)] = {0};
+	myFile.read(magic, sizeof(magic) - 1);
+	// Checks if file is in the binary columnar format:
+	if (myFile.gcount() == sizeof(magic) - 1 && string(magic) == BINARY_MAGIC){
+		// Closes the stream, since the file will be mapped instead:
+		myFile.close();
+		this->mapBinaryFile(fileLocation);
+	} else {
+		// Rewinds the stream to read the text header:
+		myFile.clear();
+		myFile.seekg(0);
+		this->readTextFile(myFile, fileLocation, numThreads);
+	}
+
+}
+
+
+// Reads a dataset in text format (three header lines followed by one register per line).
+// Registers are parsed in parallel from byte ranges of the mapped file:
+void Matrix::readTextFile(ifstream& myFile, const char* fileLocation, int numThreads){
 
 	////////////////////////////////////
 	/// RETRIEVES METADATA FROM FILE ///
@@ -32,17 +80,34 @@ Matrix::Matrix(const char* fileLocation, bool columnsSeq){
 	// Retrieves signal size:
 	getline(myFile, s);
 	istringstream tmpSignal(s);
-	tmpSignal >> m_signalSize;
+	int signalSize = 0;
+	tmpSignal >> signalSize;
 	// Retrieves background size:
 	getline(myFile, s);
 	istringstream tmpBackground(s);
-	tmpBackground >> m_backgroundSize;
+	int backgroundSize = 0;
+	tmpBackground >> backgroundSize;
 	// Retrieves number of dimenions:
 	getline(myFile, s);
 	istringstream tmpDim(s);
-	tmpDim >> m_columns;
+	int columns = 0;
+	tmpDim >> columns;
+	// Checks that the header announces a matrix that can be stored:
+	if (tmpSignal.fail() || tmpBackground.fail() || tmpDim.fail() || (signalSize < 0) || (backgroundSize < 0)
+		|| (backgroundSize > INT_MAX - signalSize) || (columns <= 0)){
+		cout << "File " << fileLocation << " has an invalid header (" << signalSize << " signal and "
+			 << backgroundSize << " background registers of " << columns << " dimensions)." << endl;
+		myFile.close();
+		return;
+	}
+	m_signalSize = signalSize;
+	m_backgroundSize = backgroundSize;
+	m_columns = columns;
 	// Calculates total rows:
 	m_rows = m_signalSize + m_backgroundSize;
+	// Saves where registers start, then closes the stream since the file will be mapped:
+	long long dataStart = myFile.tellg();
+	myFile.close();
 
 
 
@@ -50,51 +115,360 @@ Matrix::Matrix(const char* fileLocation, bool columnsSeq){
 	/// ALLOCATES SPACE ///
 	///////////////////////
 
-	// Saves matrix layout:
-	m_inverted = columnsSeq;
-
 	// Allocates storage space:
 	this->allocateSpace(true);
 
+	// Sets bitmask to second class (1) for every background register:
+	for (int i = m_signalSize; i < m_rows; i++){
+		m_class->put(i+1, true);
+	}
+
+
+	/////////////////////
+	/// MAPS THE FILE ///
+	/////////////////////
+
+	// Opens file for mapping:
+	int fd = open(fileLocation, O_RDONLY);
+	struct stat fileInfo;
+	if ((fd < 0) || (fstat(fd, &fileInfo) < 0)){
+		cout << "File " << fileLocation << " could not be opened." << endl;
+		if (fd >= 0) close(fd);
+		return;
+	}
+	// Checks if there is anything after the header:
+	if ((dataStart < 0) || (dataStart >= fileInfo.st_size)){
+		cout << "File " << fileLocation << " holds no registers." << endl;
+		close(fd);
+		return;
+	}
+	// Maps the whole file for reading:
+	char* mapping = (char*) mmap(NULL, fileInfo.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (mapping == MAP_FAILED){
+		cout << "File " << fileLocation << " could not be mapped into memory." << endl;
+		return;
+	}
+	// Every byte is read exactly once:
+	madvise(mapping, fileInfo.st_size, MADV_SEQUENTIAL);
+	const char* dataEnd = mapping + fileInfo.st_size;
+
+
+	///////////////////////////////////
+	/// SPLITS FILE AT LINE ENDINGS ///
+	///////////////////////////////////
+
+	// Uses every thread allowed, but gives each at least PARSE_MIN_CHUNK bytes:
+	long long dataSize = fileInfo.st_size - dataStart;
+	if (numThreads <= 0){
+		numThreads = ThreadPool::availableThreads();
+	}
+	numThreads = max(1LL, min((long long) numThreads, dataSize / PARSE_MIN_CHUNK));
+
+	// Chunk t covers [chunks[t], chunks[t+1]), always starting at the beginning of a line:
+	vector<const char*> chunks(numThreads + 1);
+	chunks[0] = mapping + dataStart;
+	chunks[numThreads] = dataEnd;
+	for (int t = 1; t < numThreads; t++){
+		// Starts from an even split:
+		const char* boundary = max(chunks[t-1], (const char*) mapping + dataStart + (long long) round(t * dataSize * 1.0 / numThreads));
+		// Moves boundary to right after the next line ending:
+		const char* lineEnd = (const char*) memchr(boundary, '\n', dataEnd - boundary);
+		chunks[t] = (lineEnd == NULL) ? dataEnd : lineEnd + 1;
+	}
+
 
 	///////////////////////
 	/// READS ALL LINES ///
 	///////////////////////
 
-    // Number of lines read:
-    int lineCounter = 0;
-	// Loop to read the entire input file:
-    while (getline(myFile, s)) {
-        // Helper variable to hold value of elements:
-        float value;
-		if ((s.empty() == false) && (s[0] != '#')){
-            // Increases count of lines:
-            lineCounter++;
-			// Checks if second class was reached:
-			if (lineCounter > m_signalSize){
-				// Sets bitmask to second class (1):
-				m_class->put(lineCounter, true);
+	// Counts registers in each chunk to know where each one starts:
+	vector<int> firstRow(numThreads + 1, 0);
+	vector<thread> parsingTasks(numThreads);
+	for (int t = 0; t < numThreads; t++){
+		parsingTasks[t] = thread(countTextRegisters, chunks[t], chunks[t+1], &firstRow[t+1]);
+	}
+	for (int t = 0; t < numThreads; t++){
+		parsingTasks[t].join();
+	}
+	// Turns counts into starting rows:
+	for (int t = 0; t < numThreads; t++){
+		firstRow[t+1] += firstRow[t];
+	}
+
+	// Parses every chunk straight into its rows:
+	for (int t = 0; t < numThreads; t++){
+		parsingTasks[t] = thread(&Matrix::parseTextChunk, this, chunks[t], chunks[t+1], firstRow[t]);
+	}
+	for (int t = 0; t < numThreads; t++){
+		parsingTasks[t].join();
+	}
+
+	// Warns if the header and the registers disagree:
+	if (firstRow[numThreads] != m_rows){
+		cout << "File " << fileLocation << " holds " << firstRow[numThreads] << " registers, but its header announces " << m_rows << "." << endl;
+	}
+
+	// Mapping is no longer needed:
+	munmap(mapping, fileInfo.st_size);
+	m_loaded = true;
+
+}
+
+
+// Counts the registers (non-empty lines not starting with '#') in [begin, end) and saves it in count:
+void countTextRegisters(const char* begin, const char* end, int* count){
+	int acc = 0;
+	// Loops through lines:
+	while (begin < end){
+		const char* lineEnd = (const char*) memchr(begin, '\n', end - begin);
+		if (lineEnd == NULL) lineEnd = end;
+		// Checks if line holds a register:
+		if ((lineEnd != begin) && (*begin != '#')){
+			acc++;
+		}
+		begin = lineEnd + 1;
+	}
+	*count = acc;
+}
+
+
+// Parses the registers in [begin, end) into consecutive rows starting at firstRow:
+void Matrix::parseTextChunk(const char* begin, const char* end, int firstRow){
+	// Row being filled:
+	int row = firstRow;
+	// Loops through lines, ignoring any beyond the announced number of registers:
+	while ((begin < end) && (row < m_rows)){
+		const char* lineEnd = (const char*) memchr(begin, '\n', end - begin);
+		if (lineEnd == NULL) lineEnd = end;
+		// Checks if line holds a register:
+		if ((lineEnd != begin) && (*begin != '#')){
+			const char* p = begin;
+			// Loops through elements of line:
+			for (int j = 0; j < m_columns; j++){
+				// Skips separators:
+				while ((p < lineEnd) && ((*p == ' ') || (*p == '\t') || (*p == '\r') || (*p == '+'))) p++;
+				// Parses value with the same precision the previous reader used:
+				float value = 0;
+				from_chars_result result = from_chars(p, lineEnd, value);
+				if (result.ec != errc()){
+					// Unreadable values are read as 0, skipping to the next separator:
+					value = 0;
+					while ((p < lineEnd) && (*p != ' ') && (*p != '\t')) p++;
+				} else {
+					p = result.ptr;
+				}
+				this->put(row, j, value);
 			}
-			istringstream tmp(s);
-            // Loops through elements of line:
-            for (int j = 0; j < m_columns; j++){
-                tmp >> value;
-                this->put(lineCounter-1, j, value);
-            }
+			row++;
 		}
-    }
+		begin = lineEnd + 1;
+	}
+}
+
+
+// Maps a dataset in binary columnar format into memory. Columns are used in place when
+// columnsSeq is set and the file has the precision of data_t, otherwise they are copied:
+void Matrix::mapBinaryFile(const char* fileLocation){
+
+	// Opens file for mapping:
+	int fd = open(fileLocation, O_RDONLY);
+	if (fd < 0){
+		cout << "File " << fileLocation << " could not be opened." << endl;
+		return;
+	}
+	// Retrieves file size:
+	struct stat fileInfo;
+	if ((fstat(fd, &fileInfo) < 0) || (fileInfo.st_size < (off_t)sizeof(binaryHeader))){
+		cout << "File " << fileLocation << " is too small to hold a binary header." << endl;
+		close(fd);
+		return;
+	}
+	// Maps the whole file. Pages are private, so writes never reach the file:
+	void* mapping = mmap(NULL, fileInfo.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+	// The mapping stays valid after the descriptor is closed:
+	close(fd);
+	if (mapping == MAP_FAILED){
+		cout << "File " << fileLocation << " could not be mapped into memory." << endl;
+		return;
+	}
+
+
+	////////////////////////////////////
+	/// RETRIEVES METADATA FROM FILE ///
+	////////////////////////////////////
+
+	binaryHeader* header = (binaryHeader*) mapping;
+	// Checks that the file was written by a compatible version of this program, in either precision:
+	int elementSize = header->elementSize;
+	if ((header->version != BINARY_VERSION) || ((elementSize != sizeof(float)) && (elementSize != sizeof(double)))){
+		cout << "File " << fileLocation << " has version " << header->version << " and element size "
+			 << elementSize << ", expected " << BINARY_VERSION << " and " << sizeof(float) << " or " << sizeof(double) << "." << endl;
+		munmap(mapping, fileInfo.st_size);
+		return;
+	}
+	// Checks that the sizes announced by the header are valid and fit in the int counters of the matrix
+	// (each size on its own first, so adding them can't overflow):
+	if ((header->dims <= 0) || (header->dims > INT_MAX) || (header->signalSize < 0) || (header->backgroundSize < 0)
+		|| (header->signalSize > INT_MAX) || (header->backgroundSize > INT_MAX - header->signalSize)){
+		cout << "File " << fileLocation << " has invalid sizes (" << header->signalSize << " signal and "
+			 << header->backgroundSize << " background registers of " << header->dims << " dimensions)." << endl;
+		munmap(mapping, fileInfo.st_size);
+		return;
+	}
+	// Checks that the file holds every column announced by the header (dividing, so the product can't overflow):
+	long long rows = header->signalSize + header->backgroundSize;
+	long long available = (fileInfo.st_size - sizeof(binaryHeader)) / elementSize;
+	if (rows > available / header->dims){
+		cout << "File " << fileLocation << " is truncated (" << fileInfo.st_size << " bytes can't hold " << header->dims
+			 << " columns of " << rows << " values)." << endl;
+		munmap(mapping, fileInfo.st_size);
+		return;
+	}
+	m_signalSize = header->signalSize;
+	m_backgroundSize = header->backgroundSize;
+	m_columns = header->dims;
+	// Calculates total rows:
+	m_rows = m_signalSize + m_backgroundSize;
+
+	// Columns are read once from start to end by every stage:
+	madvise(mapping, fileInfo.st_size, MADV_SEQUENTIAL);
+	// First column starts right after the header:
+	char* columns = (char*) mapping + sizeof(binaryHeader);
+
+
+	/////////////////////////////
+	/// SETS UP COLUMN ACCESS ///
+	/////////////////////////////
+
+	if (m_inverted && (elementSize == sizeof(data_t))){
+		// Uses the mapped columns as storage, no parsing or copying needed:
+		m_matrix = (data_t*) columns;
+		m_stride = m_rows;
+		// Keeps mapping alive until destruction:
+		m_mapping = mapping;
+		m_mappingSize = fileInfo.st_size;
+		// Allocates only the extra arrays, since data is already in place:
+		this->allocateExtraArrays();
+	} else {
+		// Allocates storage:
+		this->allocateSpace(true);
+		// Copies columns into storage, converting them if they were written in the other precision:
+		if (elementSize == sizeof(float)){
+			this->copyColumns((const float*) columns);
+		} else {
+			this->copyColumns((const double*) columns);
+		}
+		// Mapping is no longer needed:
+		munmap(mapping, fileInfo.st_size);
+	}
+
+	// Sets bitmask to second class (1) for every background register:
+	for (int i = m_signalSize; i < m_rows; i++){
+		m_class->put(i+1, true);
+	}
+	m_loaded = true;
+
+}
+
+
+// Copies every column of a binary file, stored one after the other with m_rows values each, into storage:
+template <class T>
+void Matrix::copyColumns(const T* columns){
+	// Fills column storage column by column and row storage row by row, so writes are sequential:
+	if (m_inverted){
+		for (int j = 0; j < m_columns; j++){
+			data_t* column = this->getColumn(j);
+			for (int i = 0; i < m_rows; i++){
+				column[i] = columns[(long long) j * m_rows + i];
+			}
+		}
+	} else {
+		for (int i = 0; i < m_rows; i++){
+			data_t* row = this->getRow(i);
+			for (int j = 0; j < m_columns; j++){
+				row[j] = columns[(long long) j * m_rows + i];
+			}
+		}
+	}
+}
+
+
+// Writes this matrix in the binary columnar format to fileLocation:
+bool Matrix::saveBinary(const char* fileLocation){
+
+	// Opens file:
+	ofstream myFile;
+	myFile.open(fileLocation, ios::binary | ios::trunc);
+	if (!myFile){
+		cout << "File " << fileLocation << " could not be created." << endl;
+		return false;
+	}
 
+	// Fills in header:
+	binaryHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, BINARY_MAGIC, sizeof(header.magic));
+	header.version = BINARY_VERSION;
+	header.elementSize = sizeof(data_t);
+	header.signalSize = m_signalSize;
+	header.backgroundSize = m_backgroundSize;
+	header.dims = m_columns;
+	myFile.write((char*) &header, sizeof(header));
+
+	// Buffer to hold one column at a time:
+	data_t* column = new data_t[m_rows];
+	// Writes columns sequentially:
+	for (int j = 0; j < m_columns; j++){
+		data_t* span = this->getColumn(j);
+		long long step = this->getColumnStep();
+		for (int i = 0; i < m_rows; i++){
+			column[i] = span[i*step];
+		}
+		myFile.write((char*) column, (long long) m_rows * sizeof(data_t));
+	}
+	delete[] column;
 
+    myFile.close();
+	// Checks that every byte reached the file:
+	if (!myFile){
+		cout << "File " << fileLocation << " could not be written." << endl;
+		return false;
+	}
+	return true;
+}
+
+
+// Converts a dataset in text format at textLocation into the binary columnar format at binaryLocation:
+bool Matrix::convertToBinary(const char* textLocation, const char* binaryLocation){
+	// Loads text file with columns stored sequentially, matching the output layout:
+	Matrix data(textLocation, true);
+	if (data.isLoaded() == false){
+		cout << "Nothing was written to " << binaryLocation << "." << endl;
+		return false;
+	}
+	// Writes it back in binary format:
+	if (data.saveBinary(binaryLocation) == false){
+		return false;
+	}
+	cout << "Converted " << data.getRows() << " registers of " << data.getDims() << " dimensions into " << binaryLocation << "." << endl;
+	return true;
 }
 
 
 // Constructor, takes a N x D parameter and allocates space:
 Matrix::Matrix(int rows, int columns, bool columnsSeq){
 
+	// Storage is not backed by a file:
+	m_matrix = NULL;
+	m_mapping = NULL;
+	m_mappingSize = 0;
+
 	// Sets up meta data:
 	m_rows = rows;
 	m_columns = columns;
 	m_inverted = columnsSeq;
+	m_loaded = true;
 
 	// Allocates storage space:
 	this->allocateSpace(false);
@@ -103,43 +477,29 @@ Matrix::Matrix(int rows, int columns, bool columnsSeq){
 
 
 // Uses previously set information to allocate storage space. If extraArrays is true, also
-// allocates space for m_class, m_cluster, m_signalDist, m_backgroundDist:
+// allocates space for m_class, m_cluster and m_clusters:
 void Matrix::allocateSpace(bool extraArrays){
+	// Number of lines (columns if stored sequentially, rows otherwise):
+	long long lines;
 	// Checks if columns should be stored sequentially:
 	if (m_inverted){
-		// Allocates *k* columns for the data matrix:
-		m_matrix = new data_t*[m_columns];
-		// Allocates *n* rows:
-		for (int j = 0; j < m_columns; j++){
-			m_matrix[j] = new data_t[m_rows];
-		}
+		// Pads every column to a multiple of MATRIX_ALIGNMENT bytes, so all columns start aligned:
+		long long perLine = MATRIX_ALIGNMENT / sizeof(data_t);
+		m_stride = ((m_rows + perLine - 1) / perLine) * perLine;
+		lines = m_columns;
 	} else {
-		// Allocates *n* rows for the data matrix:
-		m_matrix = new data_t*[m_rows];
-		// Allocates *k* columns:
-		for (int j = 0; j < m_rows; j++){
-			m_matrix[j] = new data_t[m_columns];
-        }
+		// Rows are kept dense, as consumers copy whole rows:
+		m_stride = m_columns;
+		lines = m_rows;
 	}
+	// Allocates every line in a single aligned buffer (size must be a multiple of the alignment):
+	long long bytes = m_stride * lines * sizeof(data_t);
+	bytes = ((bytes + MATRIX_ALIGNMENT - 1) / MATRIX_ALIGNMENT) * MATRIX_ALIGNMENT;
+	m_matrix = (data_t*) aligned_alloc(MATRIX_ALIGNMENT, max(bytes, (long long) MATRIX_ALIGNMENT));
 
 	// If extra arrays (described in method description) should be allocated, do it:
 	if (extraArrays == true){
-		// Allocates space for bitmask of classes:
-		m_class = new Bitmask(m_rows);
-		// Allocates space for cluster array:
-		m_cluster = new int[m_rows]();
-		// Calculates total number of clusters:
-		int totalClusters = pow(K, m_columns);
-		// Allocates space for signal distribution:
-		m_signalDist = new int[totalClusters]();
-		// Allocates space for background distribution:
-		m_backgroundDist = new int[totalClusters]();
-		// Allocates space for bitmask of contamination:
-		m_contamination = new Bitmask(totalClusters);
-		// Allocates space for bitmask to check if cluster has both classes:
-		m_hasBothClasses = new Bitmask(totalClusters);
-		// Signals that this matrix has extra information:
-		m_extraArrays = true;
+		this->allocateExtraArrays();
 	} else {
 		// Signals that this matrix doesn't have extra information:
 		m_extraArrays = false;
@@ -148,12 +508,26 @@ void Matrix::allocateSpace(bool extraArrays){
 }
 
 
+// Allocates space for m_class, m_cluster and m_clusters. Per-cluster information only grows
+// as clusters get occupied:
+void Matrix::allocateExtraArrays(){
+	// Allocates space for bitmask of classes:
+	m_class = new Bitmask(m_rows);
+	// Allocates space for cluster array:
+	m_cluster = new int[m_rows]();
+	// Allocates map of occupied clusters:
+	m_clusters = new ClusterTable();
+	// Signals that this matrix has extra information:
+	m_extraArrays = true;
+}
+
+
 // Returns a value in the matrix:
 data_t Matrix::get(int i, int j){
 	if (m_inverted){
-    	return m_matrix[j][i];
+    	return this->getView<true>().get(i, j);
 	} else {
-		return m_matrix[i][j];
+		return this->getView<false>().get(i, j);
 	}
 }
 
@@ -161,10 +535,47 @@ data_t Matrix::get(int i, int j){
 // Saves a value in the matrix:
 data_t Matrix::put(int i, int j, data_t value){
 	if (m_inverted){
-    	m_matrix[j][i] = value;
+    	this->getView<true>().put(i, j, value);
 	} else {
-		m_matrix[i][j] = value;
+		this->getView<false>().put(i, j, value);
 	}
+	return value;
+}
+
+
+// Retrieves a pointer to the first element of column j:
+data_t* Matrix::getColumn(int j){
+	return (m_inverted) ? this->getView<true>().getColumn(j) : this->getView<false>().getColumn(j);
+}
+
+
+// Retrieves the distance between consecutive elements of a column:
+long long Matrix::getColumnStep(){
+	return (m_inverted) ? this->getView<true>().getColumnStep() : this->getView<false>().getColumnStep();
+}
+
+
+// Retrieves a pointer to the first element of row i:
+data_t* Matrix::getRow(int i){
+	return (m_inverted) ? this->getView<true>().getRow(i) : this->getView<false>().getRow(i);
+}
+
+
+// Retrieves the distance between consecutive elements of a row:
+long long Matrix::getRowStep(){
+	return (m_inverted) ? this->getView<true>().getRowStep() : this->getView<false>().getRowStep();
+}
+
+
+// Retrieves if columns are stored sequentially:
+bool Matrix::isColumnsSeq(){
+	return m_inverted;
+}
+
+
+// Retrieves if the matrix holds data, i.e. its file was read successfully:
+bool Matrix::isLoaded(){
+	return m_loaded;
 }
 
 
@@ -196,8 +607,18 @@ int Matrix::getClusterOf(int i){
 
 
 
-// Saves cluster of register:
-void Matrix::putClusterOf(int i, int cluster){
+// Saves cluster of register given its code, occupying the cluster if it was empty:
+void Matrix::putClusterOf(int i, const clusterCode& code){
+	// Finds index of the cluster:
+	int cluster = m_clusters->insert(code);
+	// Checks if cluster was just occupied:
+	if (cluster == (int) m_signalDist.size()){
+		// Adds per-cluster information for it:
+		m_signalDist.push_back(0);
+		m_backgroundDist.push_back(0);
+		m_contamination.push_back(false);
+		m_hasBothClasses.push_back(false);
+	}
 	// Sets cluster of register:
 	m_cluster[i] = cluster;
 	// Increments the number of registers a cluster has:
@@ -208,6 +629,47 @@ void Matrix::putClusterOf(int i, int cluster){
 	}
 }
 
+// Saves cluster index of register without touching per-cluster information:
+void Matrix::putClusterIndexOf(int i, int cluster){
+	m_cluster[i] = cluster;
+}
+
+
+// Occupies the clusters counted in histogram and adds its counts to theirs:
+vector<int> Matrix::mergeHistogram(ClusterHistogram* histogram){
+	// Index in this matrix of each local cluster:
+	vector<int> remap(histogram->getSize());
+	for (int local = 0; local < histogram->getSize(); local++){
+		// Finds index of the cluster, occupying it if this is the first slice to reach it:
+		int cluster = m_clusters->insert(histogram->getCode(local));
+		if (cluster == (int) m_signalDist.size()){
+			// Adds per-cluster information for it:
+			m_signalDist.push_back(0);
+			m_backgroundDist.push_back(0);
+			m_contamination.push_back(false);
+			m_hasBothClasses.push_back(false);
+		}
+		// Adds the slice's counts:
+		m_signalDist[cluster] += histogram->getSignalCount(local);
+		m_backgroundDist[cluster] += histogram->getBackgroundCount(local);
+		remap[local] = cluster;
+	}
+	return remap;
+}
+
+
+// Retrieves the code of a cluster:
+clusterCode Matrix::getClusterCode(int cluster){
+	return m_clusters->getCode(cluster);
+}
+
+
+// Retrieves total number of occupied clusters:
+int Matrix::getTotalClusters(){
+	return m_clusters->getSize();
+}
+
+
 // Signals that cluster has size signal registers:
 void Matrix::putSignalDist(int cluster, int size){
 	m_signalDist[cluster] = size;
@@ -244,24 +706,24 @@ int Matrix::getBackgroundSize(){
 
 // Sets cluster as contamined by class classBool (i.e. more elements of classBool exist in this cluster):
 void Matrix::putContamination(int cluster, bool classBool){
-	m_contamination->put(cluster+1, classBool);
+	m_contamination[cluster] = classBool;
 }
 
 
 // Retrieves the class that contamines a cluster:
 bool Matrix::getContamination(int cluster){
-	return m_contamination->get(cluster+1);
+	return m_contamination[cluster];
 }
 
 // Sets cluster as having at least one element of each class:
 void Matrix::putHasBothClasses(int cluster, bool situation){
-	m_hasBothClasses->put(cluster+1, situation);
+	m_hasBothClasses[cluster] = situation;
 }
 
 
 // Retrieves if cluster has at least one register of each class:
 bool Matrix::getHasBothClasses(int cluster){
-	return m_hasBothClasses->get(cluster+1);
+	return m_hasBothClasses[cluster];
 }
 
 
@@ -290,7 +752,7 @@ void Matrix::print(int startRow, int endRow){
         cout << "]";
 		// Only prints extra array info if they have been previously allocated:
 		if (m_extraArrays == true) {
-			cout << " ---- Class " << this->getClassOf(i) << ", Cluster " << this->getClusterOf(i);
+			cout << " ---- Class " << this->getClassOf(i) << ", Cluster " << codeToString(this->getClusterCode(this->getClusterOf(i)), m_columns);
 		}
 		cout << endl;
     }
@@ -304,7 +766,7 @@ void Matrix::saveClusterDist(){
 	// Variable to hold maximum registers in a cluster:
 	int maxRegInCluster = 0;
 	// Retrieves maximum number of registers in a cluster:
-	int totalClusters = pow(K, m_columns);
+	int totalClusters = this->getTotalClusters();
 	for (int i = 0; i < totalClusters; i++){
 		// Retrieves the registers in this cluster:
 		int totalDist = this->getSignalDist(i) + this->getBackgroundDist(i);
@@ -322,20 +784,32 @@ void Matrix::saveClusterDist(){
     myFile.open("/home/cemarciano/Documents/clusterDist.txt");
 	// Writes to file the distribution of registers in clusters.
 	// E.g.: 1 300 means that 300 clusters have a single register in them.
-	for (int i = 0; i <= maxRegInCluster; i++){
+	// Clusters that were never occupied are only counted, as they are not stored:
+	myFile << 0 << " " << fixed << setprecision(0) << (pow((long double) K, m_columns) - totalClusters) << endl;
+	for (int i = 1; i <= maxRegInCluster; i++){
 		myFile << i << " " << distArr[i] << endl;
 	}
     myFile.close();
+	delete[] distArr;
 }
 
 // Destructor:
 Matrix::~Matrix(){
 
-	// Deletes every columns:
-	for (int j = 0; j < m_columns; j++){
-		delete[] m_matrix[j];
+	// Checks if storage points into a mapped file:
+	if (m_mapping != NULL){
+		// Releases the mapping instead of the storage:
+		munmap(m_mapping, m_mappingSize);
+	} else {
+		// Releases the single storage buffer:
+		free(m_matrix);
 	}
 
-    delete[] m_matrix;
+	// Deletes extra arrays:
+	if (m_extraArrays == true){
+		delete m_class;
+		delete[] m_cluster;
+		delete m_clusters;
+	}
 
 }
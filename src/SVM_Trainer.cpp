@@ -2,6 +2,9 @@
 #include <ctype.h>
 #include <stdlib.h>
 #include <iostream>
+#include <type_traits>		// To check if rows can be used in place
+#include <algorithm>			// For merging sets of support vectors
+#include <iterator>			// For appending merged sets
 
 #define Malloc(type,n) (type *)malloc((n)*sizeof(type))
 
@@ -9,15 +12,33 @@ using namespace std;
 
 
 
-SVM_Trainer::SVM_Trainer(Matrix* matrixData, SharedVector<int>* indexes, struct svm_parameter param){
+SVM_Trainer::SVM_Trainer(Matrix* matrixData, const int* indexes, int numRegisters, struct svm_parameter param, ThreadPool* pool){
 
-	m_indexes = indexes;
-	m_numRegisters = m_indexes->getSize(); //number of lines with labels
-	m_numDimensions = matrixData->getDims(); //number of features for each data vector
+	// Nothing is allocated until a problem is trained:
+	m_model = NULL;
+	m_prob.y = NULL;
+	m_prob.x = NULL;
+	m_Xspace = NULL;
+#ifdef _DENSE_REP
+	m_values = NULL;
+#endif
+
+	// Checks if the registers are worth splitting:
+	if ((pool != NULL) && (numRegisters > CASCADE_PART_SIZE)){
+		this->trainCascade(matrixData, indexes, numRegisters, param, pool);
+	} else {
+		this->train(matrixData, indexes, numRegisters, param);
+	}
+
+}
+
+
+// Trains on the numRegisters registers of data whose indices start at indexes, keeping the model:
+void SVM_Trainer::train(Matrix* data, const int* indexes, int numRegisters, struct svm_parameter param){
 
-	// Organizes data so this SVM library will accept it:
-	vector<vector<data_t>> data = this->generateData(matrixData);
-	vector<int> labels = this->generateLabels(matrixData);
+	m_indexes = indexes;
+	m_numRegisters = numRegisters; //number of lines with labels
+	m_numDimensions = data->getDims(); //number of features for each data vector
 
 	//initialize the size of the m_problem with just an int
 	m_prob.l = m_numRegisters;
@@ -26,31 +47,17 @@ SVM_Trainer::SVM_Trainer(Matrix* matrixData, SharedVector<int>* indexes, struct
 	// @param m_numDimensions = number of features for each label
 	m_prob.y = Malloc(double,m_prob.l); //space for m_prob.l doubles
 	m_prob.x = Malloc(struct svm_node *, m_prob.l); //space for m_prob.l pointers to struct svm_node
-	m_Xspace = Malloc(struct svm_node, (m_numDimensions+1) * m_prob.l); //memory for pairs of index/value
-
-	//here we are going to initialize it all a bit
-
-
-	//initialize the different lables with an array of labels
-	for (int i=0; i < m_prob.l; ++i) {
-		m_prob.y[i] = labels[i];
-	}
-	//initialize the svm_node vector with input data array as follows:
-	int j=0; //counter to traverse m_Xspace[i];
-	for (int i=0;i < m_prob.l; ++i) {
-		//set i-th element of m_prob.x to the address of m_Xspace[j].
-		//m_numDimensions from m_Xspace[j] to m_Xspace[j+data[i].size] get filled right after next line
-		m_prob.x[i] = &m_Xspace[j];
-		for (int k=0; k<data[i].size(); ++k, ++j) {
-			m_Xspace[j].index=k+1; //index of value
-			m_Xspace[j].value=data[i][k]; //value
-		}
-		m_Xspace[j].index=-1;//state the end of data vector
-		m_Xspace[j].value=0;
-
-		j++;
+#ifdef _DENSE_REP
+	m_Xspace = Malloc(struct svm_node, m_prob.l); //one dense node per register
+	m_values = NULL; //only allocated if rows have to be gathered
+#else
+	m_Xspace = Malloc(struct svm_node, (long long) (m_numDimensions+1) * m_prob.l); //memory for pairs of index/value
+#endif
 
-	}
+	// Copies labels and attributes straight from the data matrix. The linear solver regularizes the bias,
+	// so its solution depends on where the origin is; as a heuristic, it gets the registers centered on the
+	// cluster mean, which keeps the bias it needs (and so its penalty) small:
+	this->fillProblem(data, (param.kernel_type == LINEAR) && param.linear_solver);
 
 
 	//try to actually execute it
@@ -65,45 +72,224 @@ SVM_Trainer::SVM_Trainer(Matrix* matrixData, SharedVector<int>* indexes, struct
 }
 
 
-// Function to transform data into the format used by the SVM program:
-vector<vector<data_t>> SVM_Trainer::generateData(Matrix* data) {
-	// Vector to hold organized data:
-	vector<vector<data_t>> vecData;
-	// Loops through all assigned registers:
-	for (int i=0; i<m_numRegisters; ++i) {
-		// Retrieves the index of the register:
-		int index = m_indexes->get(i);
-		//cout << "Got register " << index << " of class " << data->getClassOf(index) << endl;
-		// Vector to hold attributes:
-		vector<double> featureSet;
-		// Loops through all dimensions:
-		for (int j=0; j<m_numDimensions; ++j) {
-			// Retrieves attribute from the data matrix:
-			data_t attribute = data->get(index, j);
-			// Adds attribute to the vector representing the register:
-			featureSet.push_back(attribute);
+// Trains as a cascade on pool, leaving the model of the last problem of the cascade:
+void SVM_Trainer::trainCascade(Matrix* data, const int* indexes, int numRegisters, struct svm_parameter param, ThreadPool* pool){
+
+	// Counts registers of each class:
+	int numSignal = 0;
+	for (int i = 0; i < numRegisters; i++){
+		numSignal += (data->getClassOf(indexes[i]) == 0);
+	}
+	int numBackground = numRegisters - numSignal;
+
+	// Number of parts is a power of two, so parts merge pairwise, small enough for every part to
+	// hold registers of both classes:
+	int numParts = 1;
+	while ((numRegisters > numParts * (long long) CASCADE_PART_SIZE) && (2*numParts <= min(numSignal, numBackground))){
+		numParts *= 2;
+	}
+
+	// Deals the registers of each class in turns, so parts keep the class balance of the cluster and
+	// hold their registers in increasing order:
+	vector<vector<int>> parts(numParts);
+	int nextSignal = 0, nextBackground = 0;
+	for (int i = 0; i < numRegisters; i++){
+		if (data->getClassOf(indexes[i]) == 0){
+			parts[(nextSignal++) % numParts].push_back(indexes[i]);
+		} else {
+			parts[(nextBackground++) % numParts].push_back(indexes[i]);
+		}
+	}
+
+	// Parts are trained on the threads of pool, each on a single one:
+	struct svm_parameter partParam = param;
+	partParam.parallel = NULL;
+
+	// Trains each layer and merges the support vectors of pairs of problems, until one is left:
+	vector<vector<int>> layer;
+	layer.swap(parts);
+	while (layer.size() > 1){
+		vector<vector<int>> supportVectors(layer.size());
+		pool->parallelFor(0, layer.size(), [&](int start, int end, int /*threadId*/){
+			for (int k = start; k < end; k++){
+				SVM_Trainer part(data, layer[k].data(), layer[k].size(), partParam);
+				for (int i = 0; i < part.getTotalSV(); i++){
+					supportVectors[k].push_back(part.getSV(i));
+				}
+				sort(supportVectors[k].begin(), supportVectors[k].end());
+			}
+		}, SCHEDULE_DYNAMIC);
+		layer.assign(layer.size() / 2, vector<int>());
+		for (int k = 0; k < (int) layer.size(); k++){
+			set_union(supportVectors[2*k].begin(), supportVectors[2*k].end(),
+					  supportVectors[2*k+1].begin(), supportVectors[2*k+1].end(), back_inserter(layer[k]));
+		}
+	}
+	m_cascade.swap(layer[0]);
+
+	// Loops through feedback passes, retraining the last problem on its support vectors plus the registers
+	// that violate its margin, until no register does (its model is then the one of the whole cluster). If
+	// some still do after CASCADE_MAX_PASSES passes, the whole cluster is trained instead:
+	for (int pass = 0; pass <= CASCADE_MAX_PASSES; pass++){
+
+		// Most registers are support vectors, so the cascade can't shrink the problem:
+		if (m_cascade.size() > CASCADE_MAX_FRACTION * numRegisters){
+			this->release();
+			m_cascade.clear();
+			this->train(data, indexes, numRegisters, param);
+			return;
+		}
+
+		// Trains the last problem itself, so its support vectors come out through getSV:
+		this->release();
+		this->train(data, m_cascade.data(), m_cascade.size(), param);
+
+		// Checks every register of the cluster against the model:
+		vector<int> violators = this->findViolators(data, indexes, numRegisters, param, pool);
+		if (violators.empty() == true){
+			break;
+		}
+
+		// Feedback did not converge in time, so the model can't be trusted for the whole cluster:
+		if (pass == CASCADE_MAX_PASSES){
+			this->release();
+			m_cascade.clear();
+			this->train(data, indexes, numRegisters, param);
+			return;
+		}
+		vector<int> supportVectors;
+		for (int i = 0; i < this->getTotalSV(); i++){
+			supportVectors.push_back(this->getSV(i));
+		}
+		sort(supportVectors.begin(), supportVectors.end());
+		vector<int> next;
+		set_union(supportVectors.begin(), supportVectors.end(), violators.begin(), violators.end(), back_inserter(next));
+		m_cascade.swap(next);
+	}
+
+}
+
+
+// Retrieves the registers among the numRegisters whose indices start at indexes that are not support
+// vectors of the model but lie inside its margin, i.e. would change it if trained on, sorted:
+vector<int> SVM_Trainer::findViolators(Matrix* data, const int* indexes, int numRegisters, struct svm_parameter param, ThreadPool* pool){
+	// Support vectors are allowed inside the margin:
+	vector<int> supportVectors;
+	for (int i = 0; i < this->getTotalSV(); i++){
+		supportVectors.push_back(this->getSV(i));
+	}
+	sort(supportVectors.begin(), supportVectors.end());
+
+	// Registers are checked in one slice per thread:
+	vector<vector<int>> found(pool->getNumThreads());
+	long long step = data->getRowStep();
+	pool->parallelFor(0, numRegisters, [&](int start, int end, int threadId){
+		// Node holding a register with the same centering as the problem:
+#ifdef _DENSE_REP
+		vector<double> values(m_numDimensions);
+		struct svm_node node;
+		node.dim = m_numDimensions;
+		node.values = values.data();
+		const struct svm_node* x = &node;
+#else
+		vector<struct svm_node> nodes(m_numDimensions+1);
+		for (int j=0; j < m_numDimensions; ++j) {
+			nodes[j].index = j+1;
+		}
+		nodes[m_numDimensions].index = -1;
+		nodes[m_numDimensions].value = 0;
+		const struct svm_node* x = nodes.data();
+#endif
+		for (int i = start; i < end; i++){
+			int reg = indexes[i];
+			if (binary_search(supportVectors.begin(), supportVectors.end(), reg) == true){
+				continue;
+			}
+			data_t* row = data->getRow(reg);
+			for (int j=0; j < m_numDimensions; ++j) {
+#ifdef _DENSE_REP
+				values[j] = row[j*step] - m_mean[j];
+#else
+				nodes[j].value = row[j*step] - m_mean[j];
+#endif
+			}
+			// Decision value is positive on the side of the first label of the model:
+			double decision;
+			svm_predict_values(m_model, x, &decision);
+			double margin = (data->getClassOf(reg) + 1 == m_model->label[0]) ? decision : -decision;
+			if (margin < 1 - param.eps){
+				found[threadId].push_back(reg);
+			}
 		}
-		// Adds register to data vector:
-		vecData.push_back(featureSet);
+	});
+
+	// Joins the slices:
+	vector<int> violators;
+	for (int t = 0; t < (int) found.size(); t++){
+		violators.insert(violators.end(), found[t].begin(), found[t].end());
 	}
-	// Returns the data vector:
-	return vecData;
+	sort(violators.begin(), violators.end());
+	return violators;
 }
 
 
-// Function to transform labels into the format used by the SVM program:
-vector<int> SVM_Trainer::generateLabels(Matrix* data){
-	// Vector to hold labels:
-	vector<int> labelsVec;
-	// Loops through assigned registers:
+// Fills labels and nodes of m_prob straight from the registers of the data matrix, optionally
+// subtracting their mean:
+void SVM_Trainer::fillProblem(Matrix* data, bool center){
+	// Retrieves distance between elements of a row:
+	long long step = data->getRowStep();
+	// Mean of each attribute over the registers (kept at zero if not centering):
+	m_mean.assign(m_numDimensions, 0);
+	if (center == true){
+		for (int i=0; i < m_numRegisters; ++i) {
+			data_t* row = data->getRow(m_indexes[i]);
+			for (int j=0; j < m_numDimensions; ++j) {
+				m_mean[j] += row[j*step];
+			}
+		}
+		for (int j=0; j < m_numDimensions; ++j) {
+			m_mean[j] /= m_numRegisters;
+		}
+	}
+#ifdef _DENSE_REP
+	// Contiguous rows of doubles are used in place, anything else is gathered into m_values:
+	bool inPlace = (step == 1) && is_same<data_t, double>::value && (center == false);
+	if (inPlace == false){
+		m_values = Malloc(double, (long long) m_numDimensions * m_prob.l);
+	}
+#endif
+	// Loops through all assigned registers:
 	for (int i=0; i < m_numRegisters; ++i) {
 		// Retrieves label (and adds 1 since SVM goes [1,inf) ):
-		int label = data->getClassOf(m_indexes->get(i)) + 1;
-		// Adds label to labels vector:
-		labelsVec.push_back(label);
+		m_prob.y[i] = data->getClassOf(m_indexes[i]) + 1;
+		// Retrieves the row of the register:
+		data_t* row = data->getRow(m_indexes[i]);
+#ifdef _DENSE_REP
+		// Register i is a single node holding its m_numDimensions values:
+		struct svm_node* node = &m_Xspace[i];
+		m_prob.x[i] = node;
+		node->dim = m_numDimensions;
+		if (inPlace == true){
+			node->values = (double*) row;
+		} else {
+			node->values = &m_values[(long long) i * m_numDimensions];
+			for (int j=0; j < m_numDimensions; ++j) {
+				node->values[j] = row[j*step] - m_mean[j];
+			}
+		}
+#else
+		// Register i uses m_numDimensions+1 consecutive nodes, the last one ending the vector:
+		struct svm_node* nodes = &m_Xspace[(long long) i * (m_numDimensions+1)];
+		m_prob.x[i] = nodes;
+		// Copies attributes from the row of the register:
+		for (int j=0; j < m_numDimensions; ++j) {
+			nodes[j].index = j+1;
+			nodes[j].value = row[j*step] - m_mean[j];
+		}
+		nodes[m_numDimensions].index = -1;
+		nodes[m_numDimensions].value = 0;
+#endif
 	}
-	// Return labels vector:
-	return labelsVec;
 }
 
 
@@ -116,10 +302,30 @@ int SVM_Trainer::getTotalSV(){
 // Returns an array of indices corresponding to support vectors:
 int SVM_Trainer::getSV(int i){
 	// Returns the index in the data matrix corresponding to the i-th SV:
-	return m_indexes->get(m_model->sv_indices[i]-1);
+	return m_indexes[m_model->sv_indices[i]-1];
+}
+
+
+// Frees the model and the problem it was trained on:
+void SVM_Trainer::release(){
+	// Model points into m_Xspace, so it goes first:
+	if (m_model != NULL){
+		svm_free_and_destroy_model(&m_model);
+	}
+	free(m_prob.y);
+	free(m_prob.x);
+	free(m_Xspace);
+	m_prob.y = NULL;
+	m_prob.x = NULL;
+	m_Xspace = NULL;
+#ifdef _DENSE_REP
+	free(m_values);
+	m_values = NULL;
+#endif
 }
 
 
 // Destructor:
 SVM_Trainer::~SVM_Trainer(){
+	this->release();
 }
@@ -1,5 +1,7 @@
 #include <SharedVector.h>
 #include <iostream>
+#include <algorithm>		// For searching offsets
+#include <cassert>			// For checking offsets are built
 
 using namespace std;
 
@@ -7,16 +9,11 @@ template<class T>
 SharedVector<T>::SharedVector(int numThreads){
 	// Saves number of threads:
 	m_numThreads = numThreads;
-	// Sets size:
-	m_size = 0;
-	m_sizeHasChanged = false;
-	// Loops through number of threads:
-	for (int i=0; i < m_numThreads; i++){
-		// Creates a new vector for this thread:
-		vector<T> threadVec;
-		// Pushes this vector to the shared vector:
-		m_vector.push_back(threadVec);
-	}
+	// Creates one vector per thread:
+	m_vector.resize(m_numThreads);
+	// Every thread starts at offset 0:
+	m_offsets.assign(m_numThreads + 1, 0);
+	m_finalized = true;
 }
 
 
@@ -24,16 +21,13 @@ SharedVector<T>::SharedVector(int numThreads){
 // Retrieves the index-th value as if the vectors were a continous space:
 template <class T>
 T SharedVector<T>::get(int index){
-	// Checks which vector this index belongs to.
-	// Checks if subtracting vector size from index makes it negative:
-	int vec = 0;
-	while (index >= m_vector[vec].size()){
-		// Keeps searching:
-		index -= m_vector[vec].size();
-		vec++;
-	}
+	// Offsets must describe every element pushed so far:
+	assert(m_finalized == true);
+	// Finds the vector this index belongs to (the last one starting at or before it), searching
+	// only the numThreads offsets:
+	int vec = upper_bound(m_offsets.begin() + 1, m_offsets.end(), index) - m_offsets.begin() - 1;
 	// Returns the element from vector vec:
-	return (m_vector[vec])[index];
+	return (m_vector[vec])[index - m_offsets[vec]];
 }
 
 
@@ -42,27 +36,59 @@ template<class T>
 void SharedVector<T>::push(T value, int threadId){
 	// Adds value to the corresponding vector:
 	m_vector[threadId].push_back(value);
-	// Signals that size has changed:
-	m_sizeHasChanged = true;
+	// Offsets are stale until the next finalize:
+	m_finalized = false;
 }
 
 
 // Returns total number of elements across all vectors:
 template<class T>
 int SharedVector<T>::getSize(){
-	// Checks if size needs to be calculated:
-	if (m_sizeHasChanged == true){
-		// Accumulator variable:
-		m_size = 0;
-		// Sums all vectors:
-		for (int i=0; i < m_vector.size(); i++){
-			m_size += m_vector[i].size();
-		}
+	// Adds the size of each vector, so the result is exact even before finalize:
+	long long size = 0;
+	for (int i=0; i < m_numThreads; i++){
+		size += m_vector[i].size();
+	}
+	return size;
+}
+
+
+// Builds the offsets read by get:
+template<class T>
+void SharedVector<T>::finalize(){
+	// Prefix sums of vector sizes:
+	for (int i=0; i < m_numThreads; i++){
+		m_offsets[i+1] = m_offsets[i] + m_vector[i].size();
+	}
+	// Sets offsets as calculated:
+	m_finalized = true;
+}
+
+
+// Returns a single contiguous copy of every element, in index order:
+template<class T>
+vector<T> SharedVector<T>::flatten(){
+	vector<T> flat;
+	flat.reserve(this->getSize());
+	// Appends each thread's vector in order:
+	for (int i=0; i < m_numThreads; i++){
+		flat.insert(flat.end(), m_vector[i].begin(), m_vector[i].end());
 	}
-	// Sets size as calculated:
-	m_sizeHasChanged = false;
-	// Returns the size:
-	return m_size;
+	return flat;
+}
+
+
+// Retrieves an iterator to the first element:
+template<class T>
+typename SharedVector<T>::iterator SharedVector<T>::begin(){
+	return iterator(this, 0, 0);
+}
+
+
+// Retrieves an iterator past the last element:
+template<class T>
+typename SharedVector<T>::iterator SharedVector<T>::end(){
+	return iterator(this, m_numThreads, 0);
 }
 
 
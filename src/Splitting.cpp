@@ -0,0 +1,108 @@
+#include "Splitting.h"
+#include "Simd.h"			// Shared SIMD helpers
+
+using namespace std;
+
+
+// Adds bin << shift to codes for n contiguous values, without SIMD:
+static void binsScalar(const data_t* x, int n, const data_t* limits, int numLimits, int shift, unsigned long long* codes){
+	for (int i = 0; i < n; i++){
+		// Counts limits to the left of (or at) the value:
+		int bin = 0;
+		for (int k = 0; k < numLimits; k++){
+			bin += (limits[k] <= x[i]);
+		}
+		codes[i] += ((unsigned long long) bin) << shift;
+	}
+}
+
+
+#ifdef SIMD_X86
+
+// Adds bin << shift to codes for n contiguous values, four at a time with AVX2 lanes:
+__attribute__((target("avx2")))
+static void binsAVX2(const data_t* x, int n, const data_t* limits, int numLimits, int shift, unsigned long long* codes){
+	__m256d one = _mm256_set1_pd(1.0);
+	__m128i count = _mm_cvtsi32_si128(shift);
+	int i = 0;
+	for (; i + 4 <= n; i += 4){
+		__m256d value = load4(x + i);
+		// Counts limits to the left of (or at) each value:
+		__m256d bin = _mm256_setzero_pd();
+		for (int k = 0; k < numLimits; k++){
+			__m256d below = _mm256_cmp_pd(_mm256_set1_pd(limits[k]), value, _CMP_LE_OQ);
+			bin = _mm256_add_pd(bin, _mm256_and_pd(below, one));
+		}
+		// Accumulates bin << shift into the codes:
+		__m256i code = _mm256_loadu_si256((__m256i*) (codes + i));
+		code = _mm256_add_epi64(code, _mm256_sll_epi64(_mm256_cvtepi32_epi64(_mm256_cvtpd_epi32(bin)), count));
+		_mm256_storeu_si256((__m256i*) (codes + i), code);
+	}
+	binsScalar(x + i, n - i, limits, numLimits, shift, codes + i);
+}
+
+
+// Adds bin << shift to codes for n contiguous values, eight at a time with AVX-512 lanes:
+__attribute__((target("avx512f")))
+static void binsAVX512(const data_t* x, int n, const data_t* limits, int numLimits, int shift, unsigned long long* codes){
+	__m512d one = _mm512_set1_pd(1.0);
+	__m128i count = _mm_cvtsi32_si128(shift);
+	int i = 0;
+	for (; i + 8 <= n; i += 8){
+		__m512d value = load8(x + i);
+		// Counts limits to the left of (or at) each value:
+		__m512d bin = _mm512_setzero_pd();
+		for (int k = 0; k < numLimits; k++){
+			__mmask8 below = _mm512_cmp_pd_mask(_mm512_set1_pd(limits[k]), value, _CMP_LE_OQ);
+			bin = _mm512_mask_add_pd(bin, below, bin, one);
+		}
+		// Accumulates bin << shift into the codes:
+		__m512i code = _mm512_loadu_si512(codes + i);
+		code = _mm512_add_epi64(code, _mm512_sll_epi64(_mm512_cvtepi32_epi64(_mm512_cvtpd_epi32(bin)), count));
+		_mm512_storeu_si512(codes + i, code);
+	}
+	binsScalar(x + i, n - i, limits, numLimits, shift, codes + i);
+}
+
+#endif // SIMD_X86
+
+
+// Kernel used for contiguous blocks, selected once for this CPU:
+typedef void (*binsKernel)(const data_t*, int, const data_t*, int, int, unsigned long long*);
+static binsKernel selectBinsKernel(const char** name){
+#ifdef SIMD_X86
+	if (__builtin_cpu_supports("avx512f")){
+		*name = "AVX-512";
+		return binsAVX512;
+	}
+	if (__builtin_cpu_supports("avx2")){
+		*name = "AVX2";
+		return binsAVX2;
+	}
+#endif
+	*name = "scalar";
+	return binsScalar;
+}
+static const char* kernelName;
+static const binsKernel bins = selectBinsKernel(&kernelName);
+
+
+// Adds bin << shift to codes[i] for count values spaced step apart:
+void assignBins(const data_t* values, long long step, int count, const data_t* limits, int numLimits, int shift, unsigned long long* codes){
+	// Strided values are gathered into a contiguous block first:
+	if (step != 1){
+		data_t block[SPLIT_BLOCK];
+		for (int i = 0; i < count; i++){
+			block[i] = values[i*step];
+		}
+		bins(block, count, limits, numLimits, shift, codes);
+	} else {
+		bins(values, count, limits, numLimits, shift, codes);
+	}
+}
+
+
+// Retrieves the name of the kernel selected for this CPU:
+const char* assignBinsKernel(){
+	return kernelName;
+}
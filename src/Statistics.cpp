@@ -0,0 +1,194 @@
+#include "Statistics.h"
+#include "Simd.h"			// Shared SIMD helpers
+#include <algorithm>		// For block sizes
+
+using namespace std;
+
+
+// Calculates statistics of n contiguous values, without SIMD:
+static columnStats blockStatsScalar(const data_t* x, long long n){
+	// Four accumulators keep independent chains in flight:
+	double s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+	long long i = 0;
+	for (; i + 4 <= n; i += 4){
+		s0 += x[i];
+		s1 += x[i+1];
+		s2 += x[i+2];
+		s3 += x[i+3];
+	}
+	for (; i < n; i++){
+		s0 += x[i];
+	}
+	double mean = ((s0 + s1) + (s2 + s3)) / n;
+
+	// Squared deviations from the block mean, while the block is still in cache:
+	s0 = s1 = s2 = s3 = 0;
+	for (i = 0; i + 4 <= n; i += 4){
+		double d0 = x[i] - mean, d1 = x[i+1] - mean, d2 = x[i+2] - mean, d3 = x[i+3] - mean;
+		s0 += d0*d0;
+		s1 += d1*d1;
+		s2 += d2*d2;
+		s3 += d3*d3;
+	}
+	for (; i < n; i++){
+		double d = x[i] - mean;
+		s0 += d*d;
+	}
+	columnStats stats = {n, mean, (s0 + s1) + (s2 + s3)};
+	return stats;
+}
+
+
+#ifdef SIMD_X86
+
+// Adds the four lanes of an AVX register:
+__attribute__((target("avx2")))
+static inline double reduceAVX2(__m256d v){
+	__m128d sum = _mm_add_pd(_mm256_castpd256_pd128(v), _mm256_extractf128_pd(v, 1));
+	return _mm_cvtsd_f64(_mm_add_sd(sum, _mm_unpackhi_pd(sum, sum)));
+}
+
+
+// Calculates statistics of n contiguous values with AVX2 lanes, always accumulating in double:
+__attribute__((target("avx2,fma")))
+static columnStats blockStatsAVX2(const data_t* x, long long n){
+	__m256d s0 = _mm256_setzero_pd(), s1 = _mm256_setzero_pd(), s2 = _mm256_setzero_pd(), s3 = _mm256_setzero_pd();
+	long long i = 0;
+	for (; i + 16 <= n; i += 16){
+		s0 = _mm256_add_pd(s0, load4(x + i));
+		s1 = _mm256_add_pd(s1, load4(x + i + 4));
+		s2 = _mm256_add_pd(s2, load4(x + i + 8));
+		s3 = _mm256_add_pd(s3, load4(x + i + 12));
+	}
+	double sum = reduceAVX2(_mm256_add_pd(_mm256_add_pd(s0, s1), _mm256_add_pd(s2, s3)));
+	for (; i < n; i++){
+		sum += x[i];
+	}
+	double mean = sum / n;
+
+	// Squared deviations from the block mean, while the block is still in cache:
+	__m256d m = _mm256_set1_pd(mean);
+	s0 = s1 = s2 = s3 = _mm256_setzero_pd();
+	for (i = 0; i + 16 <= n; i += 16){
+		__m256d d0 = _mm256_sub_pd(load4(x + i), m);
+		__m256d d1 = _mm256_sub_pd(load4(x + i + 4), m);
+		__m256d d2 = _mm256_sub_pd(load4(x + i + 8), m);
+		__m256d d3 = _mm256_sub_pd(load4(x + i + 12), m);
+		s0 = _mm256_fmadd_pd(d0, d0, s0);
+		s1 = _mm256_fmadd_pd(d1, d1, s1);
+		s2 = _mm256_fmadd_pd(d2, d2, s2);
+		s3 = _mm256_fmadd_pd(d3, d3, s3);
+	}
+	double m2 = reduceAVX2(_mm256_add_pd(_mm256_add_pd(s0, s1), _mm256_add_pd(s2, s3)));
+	for (; i < n; i++){
+		double d = x[i] - mean;
+		m2 += d*d;
+	}
+	columnStats stats = {n, mean, m2};
+	return stats;
+}
+
+
+// Calculates statistics of n contiguous values with AVX-512 lanes, always accumulating in double:
+__attribute__((target("avx512f")))
+static columnStats blockStatsAVX512(const data_t* x, long long n){
+	__m512d s0 = _mm512_setzero_pd(), s1 = _mm512_setzero_pd(), s2 = _mm512_setzero_pd(), s3 = _mm512_setzero_pd();
+	long long i = 0;
+	for (; i + 32 <= n; i += 32){
+		s0 = _mm512_add_pd(s0, load8(x + i));
+		s1 = _mm512_add_pd(s1, load8(x + i + 8));
+		s2 = _mm512_add_pd(s2, load8(x + i + 16));
+		s3 = _mm512_add_pd(s3, load8(x + i + 24));
+	}
+	double sum = _mm512_reduce_add_pd(_mm512_add_pd(_mm512_add_pd(s0, s1), _mm512_add_pd(s2, s3)));
+	for (; i < n; i++){
+		sum += x[i];
+	}
+	double mean = sum / n;
+
+	// Squared deviations from the block mean, while the block is still in cache:
+	__m512d m = _mm512_set1_pd(mean);
+	s0 = s1 = s2 = s3 = _mm512_setzero_pd();
+	for (i = 0; i + 32 <= n; i += 32){
+		__m512d d0 = _mm512_sub_pd(load8(x + i), m);
+		__m512d d1 = _mm512_sub_pd(load8(x + i + 8), m);
+		__m512d d2 = _mm512_sub_pd(load8(x + i + 16), m);
+		__m512d d3 = _mm512_sub_pd(load8(x + i + 24), m);
+		s0 = _mm512_fmadd_pd(d0, d0, s0);
+		s1 = _mm512_fmadd_pd(d1, d1, s1);
+		s2 = _mm512_fmadd_pd(d2, d2, s2);
+		s3 = _mm512_fmadd_pd(d3, d3, s3);
+	}
+	double m2 = _mm512_reduce_add_pd(_mm512_add_pd(_mm512_add_pd(s0, s1), _mm512_add_pd(s2, s3)));
+	for (; i < n; i++){
+		double d = x[i] - mean;
+		m2 += d*d;
+	}
+	columnStats stats = {n, mean, m2};
+	return stats;
+}
+
+#endif // SIMD_X86
+
+
+// Kernel used for contiguous blocks, selected once for this CPU:
+typedef columnStats (*blockKernel)(const data_t*, long long);
+static blockKernel selectBlockKernel(const char** name){
+#ifdef SIMD_X86
+	if (__builtin_cpu_supports("avx512f")){
+		*name = "AVX-512";
+		return blockStatsAVX512;
+	}
+	if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")){
+		*name = "AVX2";
+		return blockStatsAVX2;
+	}
+#endif
+	*name = "scalar";
+	return blockStatsScalar;
+}
+static const char* kernelName;
+static const blockKernel blockStats = selectBlockKernel(&kernelName);
+
+
+// Merges statistics of two disjoint sets of values (Chan et al., 1979):
+columnStats mergeColumnStats(columnStats a, columnStats b){
+	// Merging with an empty set changes nothing:
+	if (a.count == 0) return b;
+	if (b.count == 0) return a;
+	long long count = a.count + b.count;
+	double delta = b.mean - a.mean;
+	columnStats stats;
+	stats.count = count;
+	stats.mean = a.mean + delta * b.count / count;
+	stats.m2 = a.m2 + b.m2 + delta * delta * a.count * b.count / count;
+	return stats;
+}
+
+
+// Calculates statistics of count values spaced step apart in a single pass over memory:
+columnStats computeColumnStats(const data_t* values, long long step, long long count){
+	columnStats stats = {0, 0, 0};
+	// Buffer to gather strided values into a contiguous block:
+	data_t block[STATS_BLOCK];
+	// Loops through blocks:
+	for (long long start = 0; start < count; start += STATS_BLOCK){
+		long long n = min((long long) STATS_BLOCK, count - start);
+		const data_t* x = values + start*step;
+		// Strided values are gathered first, contiguous ones are used in place:
+		if (step != 1){
+			for (long long i = 0; i < n; i++){
+				block[i] = x[i*step];
+			}
+			x = block;
+		}
+		stats = mergeColumnStats(stats, blockStats(x, n));
+	}
+	return stats;
+}
+
+
+// Retrieves the name of the kernel selected for this CPU:
+const char* columnStatsKernel(){
+	return kernelName;
+}
@@ -0,0 +1,176 @@
+#include "ThreadPool.h"
+#include <atomic>			// For claiming chunks
+#include <cmath>			// For rounding slices
+#include <fstream>			// For reading cgroup limits
+#ifdef __linux__
+#include <sched.h>			// For the CPU affinity mask
+#endif
+
+using namespace std;
+
+// Constructor, starts numThreads-1 worker threads:
+ThreadPool::ThreadPool(int numThreads){
+	m_numThreads = max(1, numThreads);
+	m_job = NULL;
+	m_active = 0;
+	m_generation = 0;
+	m_pending = 0;
+	m_stop = false;
+	// Calling thread is thread 0:
+	for (int threadId = 1; threadId < m_numThreads; threadId++){
+		m_workers.push_back(thread(&ThreadPool::workerLoop, this, threadId));
+	}
+}
+
+
+// Retrieves total number of threads, counting the calling one:
+int ThreadPool::getNumThreads(){
+	return m_numThreads;
+}
+
+
+// Retrieves the CPU quota of this process's cgroup in CPUs, or 0 if there is none:
+static double cgroupQuota(){
+	// cgroup v2 holds "quota period", or "max period" when unlimited:
+	ifstream v2("/sys/fs/cgroup/cpu.max");
+	string quota;
+	double period;
+	if (v2 >> quota >> period){
+		return ((quota == "max") || (period <= 0)) ? 0 : stod(quota) / period;
+	}
+	// cgroup v1 holds quota and period in separate files, with a quota of -1 when unlimited:
+	ifstream v1Quota("/sys/fs/cgroup/cpu/cpu.cfs_quota_us");
+	ifstream v1Period("/sys/fs/cgroup/cpu/cpu.cfs_period_us");
+	double quotaUs;
+	if ((v1Quota >> quotaUs) && (v1Period >> period) && (quotaUs > 0) && (period > 0)){
+		return quotaUs / period;
+	}
+	return 0;
+}
+
+
+// Retrieves how many threads this process can run at once:
+int ThreadPool::availableThreads(){
+	// Every CPU of the machine, as a fallback:
+	int count = max(1u, thread::hardware_concurrency());
+#ifdef __linux__
+	// Only CPUs this process may be scheduled on:
+	cpu_set_t mask;
+	if (sched_getaffinity(0, sizeof(mask), &mask) == 0){
+		count = max(1, CPU_COUNT(&mask));
+	}
+	// A quota of 2.5 CPUs still keeps 3 threads busy part of the time:
+	double quota = cgroupQuota();
+	if (quota > 0){
+		count = max(1, min(count, (int) ceil(quota)));
+	}
+#endif
+	return count;
+}
+
+
+// Runs job(threadId) once on each of the first numThreads threads and waits until all are done:
+void ThreadPool::run(const function<void(int threadId)>& job, int numThreads){
+	if ((numThreads <= 0) || (numThreads > m_numThreads)){
+		numThreads = m_numThreads;
+	}
+	// Posts job to the workers:
+	{
+		lock_guard<mutex> lock(m_mutex);
+		m_job = &job;
+		m_active = numThreads;
+		m_pending = numThreads - 1;
+		m_generation++;
+	}
+	m_wake.notify_all();
+	// Calling thread does its share:
+	job(0);
+	// Waits until all workers are done:
+	unique_lock<mutex> lock(m_mutex);
+	m_done.wait(lock, [this]{ return m_pending == 0; });
+}
+
+
+// Runs body over chunks covering [begin, end) and waits until all are done:
+void ThreadPool::parallelFor(int begin, int end, const function<void(int start, int end, int threadId)>& body,
+							 schedule_t schedule, int chunk){
+	chunk = max(1, chunk);
+	// Next index to hand out, for dynamic and guided schedules:
+	atomic<int> next(begin);
+
+	if (schedule == SCHEDULE_STATIC){
+		this->run([&](int threadId){
+			// Number of indices per thread:
+			double each = (end - begin)*1.0 / m_numThreads;
+			// Calculates chunck:
+			int start = begin + round(threadId*each);
+			int stop = begin + round((threadId+1)*each);
+			body(start, stop, threadId);
+		});
+	} else if (schedule == SCHEDULE_DYNAMIC){
+		this->run([&](int threadId){
+			// Claims fixed-size chunks until the range is exhausted:
+			for (int start = next.fetch_add(chunk); start < end; start = next.fetch_add(chunk)){
+				body(start, min(start + chunk, end), threadId);
+			}
+		});
+	} else {
+		this->run([&](int threadId){
+			int start = next.load();
+			while (start < end){
+				// Takes a share of what is left, never less than chunk:
+				int size = min(max(chunk, (end - start) / (2*m_numThreads)), end - start);
+				// Claims it unless another thread got there first (start is then reloaded):
+				if (next.compare_exchange_weak(start, start + size)){
+					body(start, start + size, threadId);
+					start = next.load();
+				}
+			}
+		});
+	}
+}
+
+
+// Loop run by each worker thread, waiting for jobs until the pool stops:
+void ThreadPool::workerLoop(int threadId){
+	long long seen = 0;
+	while (true){
+		const function<void(int)>* job;
+		// Waits for a job newer than the last one run:
+		{
+			unique_lock<mutex> lock(m_mutex);
+			m_wake.wait(lock, [this, seen]{ return m_stop || (m_generation != seen); });
+			if (m_stop){
+				return;
+			}
+			seen = m_generation;
+			job = m_job;
+			// Skips jobs meant for fewer threads:
+			if (threadId >= m_active){
+				continue;
+			}
+		}
+		(*job)(threadId);
+		// Signals the calling thread if this was the last worker:
+		{
+			lock_guard<mutex> lock(m_mutex);
+			m_pending--;
+			if (m_pending == 0){
+				m_done.notify_one();
+			}
+		}
+	}
+}
+
+
+// Destructor, stops and joins worker threads:
+ThreadPool::~ThreadPool(){
+	{
+		lock_guard<mutex> lock(m_mutex);
+		m_stop = true;
+	}
+	m_wake.notify_all();
+	for (int i = 0; i < (int) m_workers.size(); i++){
+		m_workers[i].join();
+	}
+}
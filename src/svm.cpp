@@ -8,6 +8,9 @@
 #include <limits.h>
 #include <locale.h>
 #include "svm.h"
+#if defined(_DENSE_REP) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#endif
 int libsvm_version = LIBSVM_VERSION;
 typedef float Qfloat;
 typedef signed char schar;
@@ -75,113 +78,143 @@ public:
 	// (p >= len if nothing needs to be filled)
 	int get_data(const int index, Qfloat **data, int len);
 	void swap_index(int i, int j);
+	int get_num_slots() const { return num_slots; }	// columns cached at once
 private:
 	int l;
-	long int size;
-	struct head_t
-	{
-		head_t *prev, *next;	// a circular list
-		Qfloat *data;
-		int len;		// data[0,len) is cached in this entry
+	int num_slots;		// columns the slab holds
+	int used;		// slots handed out so far, slots [0,used) always hold a column
+	Qfloat *slab;		// num_slots columns of l entries each, allocated once
+	struct slot_t
+	{
+		int prev, next;	// a circular list of slots, slot num_slots heads it
+		int index;	// column held in this slot
+		int len;	// data[0,len) is cached in this slot
+		int synced;	// entries of swap_log already applied to this slot
 	};
-
-	head_t *head;
-	head_t lru_head;
-	void lru_delete(head_t *h);
-	void lru_insert(head_t *h);
+	slot_t *slots;
+	int *slot_of;		// slot holding each column, -1 if not cached
+	int *swap_log;		// pairs (i,j), i<j, of entries to swap in every cached column
+	int swap_count;
+	void lru_delete(int s);
+	void lru_insert(int s);
+	void sync(int s);
+	void flush();
 };
 
-Cache::Cache(int l_,long int size_):l(l_),size(size_)
+Cache::Cache(int l_,long int size_):l(l_)
 {
-	head = (head_t *)calloc(l,sizeof(head_t));	// initialized to 0
-	size /= sizeof(Qfloat);
-	size -= l * sizeof(head_t) / sizeof(Qfloat);
+	long int size = size_ / sizeof(Qfloat);
+	size -= l * (sizeof(int) * 3 + sizeof(slot_t)) / sizeof(Qfloat);
 	size = max(size, 2 * (long int) l);	// cache must be large enough for two columns
-	lru_head.next = lru_head.prev = &lru_head;
+	num_slots = (int) min((long int) max(l,2), size / max(l,1));
+	slab = Malloc(Qfloat,(long int) num_slots * l);
+	slots = Malloc(slot_t,num_slots+1);
+	slot_of = Malloc(int,l);
+	swap_log = Malloc(int,2*l);
+	for(int i=0;i<l;i++)
+		slot_of[i] = -1;
+	used = 0;
+	swap_count = 0;
+	slots[num_slots].next = slots[num_slots].prev = num_slots;
 }
 
 Cache::~Cache()
 {
-	for(head_t *h = lru_head.next; h != &lru_head; h=h->next)
-		free(h->data);
-	free(head);
+	free(slab);
+	free(slots);
+	free(slot_of);
+	free(swap_log);
 }
 
-void Cache::lru_delete(head_t *h)
+void Cache::lru_delete(int s)
 {
 	// delete from current location
-	h->prev->next = h->next;
-	h->next->prev = h->prev;
+	slots[slots[s].prev].next = slots[s].next;
+	slots[slots[s].next].prev = slots[s].prev;
 }
 
-void Cache::lru_insert(head_t *h)
+void Cache::lru_insert(int s)
 {
 	// insert to last position
-	h->next = &lru_head;
-	h->prev = lru_head.prev;
-	h->prev->next = h;
-	h->next->prev = h;
+	slots[s].next = num_slots;
+	slots[s].prev = slots[num_slots].prev;
+	slots[slots[s].prev].next = s;
+	slots[num_slots].prev = s;
 }
 
-int Cache::get_data(const int index, Qfloat **data, int len)
+void Cache::sync(int s)
+{
+	// apply swaps logged since the slot was last used
+	slot_t *h = &slots[s];
+	Qfloat *data = slab + (long int) s * l;
+	for(int k=h->synced;k<swap_count;k++)
+	{
+		int i = swap_log[2*k], j = swap_log[2*k+1];
+		if(h->len > j)
+			swap(data[i],data[j]);
+		else if(h->len > i)
+			h->len = i;	// entries [0,i) are still valid
+	}
+	h->synced = swap_count;
+}
+
+void Cache::flush()
 {
-	head_t *h = &head[index];
-	if(h->len) lru_delete(h);
-	int more = len - h->len;
+	for(int s=0;s<used;s++)
+	{
+		sync(s);
+		slots[s].synced = 0;
+	}
+	swap_count = 0;
+}
 
-	if(more > 0)
+int Cache::get_data(const int index, Qfloat **data, int len)
+{
+	int s = slot_of[index];
+	if(s >= 0)
 	{
-		// free old space
-		while(size < more)
+		lru_delete(s);
+		sync(s);
+	}
+	else
+	{
+		// take a slot never used, or the least recently used one
+		if(used < num_slots)
+			s = used++;
+		else
 		{
-			head_t *old = lru_head.next;
-			lru_delete(old);
-			free(old->data);
-			size += old->len;
-			old->data = 0;
-			old->len = 0;
+			s = slots[num_slots].next;
+			lru_delete(s);
+			slot_of[slots[s].index] = -1;
 		}
-
-		// allocate new space
-		h->data = (Qfloat *)realloc(h->data,sizeof(Qfloat)*len);
-		size -= more;
-		swap(h->len,len);
+		slots[s].index = index;
+		slots[s].len = 0;
+		slots[s].synced = swap_count;
+		slot_of[index] = s;
 	}
 
-	lru_insert(h);
-	*data = h->data;
-	return len;
+	lru_insert(s);
+	*data = slab + (long int) s * l;
+	int cached = slots[s].len;
+	if(len > cached)
+		slots[s].len = len;
+	return cached;
 }
 
 void Cache::swap_index(int i, int j)
 {
 	if(i==j) return;
 
-	if(head[i].len) lru_delete(&head[i]);
-	if(head[j].len) lru_delete(&head[j]);
-	swap(head[i].data,head[j].data);
-	swap(head[i].len,head[j].len);
-	if(head[i].len) lru_insert(&head[i]);
-	if(head[j].len) lru_insert(&head[j]);
+	// columns follow their indices
+	swap(slot_of[i],slot_of[j]);
+	if(slot_of[i] >= 0) slots[slot_of[i]].index = i;
+	if(slot_of[j] >= 0) slots[slot_of[j]].index = j;
 
-	if(i>j) swap(i,j);
-	for(head_t *h = lru_head.next; h!=&lru_head; h=h->next)
-	{
-		if(h->len > i)
-		{
-			if(h->len > j)
-				swap(h->data[i],h->data[j]);
-			else
-			{
-				// give up
-				lru_delete(h);
-				free(h->data);
-				size += h->len;
-				h->data = 0;
-				h->len = 0;
-			}
-		}
-	}
+	// entries i and j of cached columns are swapped when each column is next used
+	if(swap_count == l) flush();
+	swap_log[2*swap_count] = min(i,j);
+	swap_log[2*swap_count+1] = max(i,j);
+	swap_count++;
 }
 
 //
@@ -191,14 +224,43 @@ void Cache::swap_index(int i, int j)
 // the constructor of Kernel prepares to calculate the l*l kernel matrix
 // the member function get_Q is for getting one column from the Q Matrix
 //
+//
+// Runs body(start,end) over [begin,end), split across the caller's threads when
+// parallel is set and the range is long enough
+//
+template <class F>
+static void parallel_range(const svm_parallel *parallel, int begin, int end, F body)
+{
+	if(parallel == NULL || end - begin < 2*parallel->min_len)
+		body(begin,end);
+	else
+		parallel->parallel_for(parallel->pool, begin, end,
+			[](int start, int stop, void *arg) { (*(F *)arg)(start,stop); }, &body);
+}
+
 class QMatrix {
 public:
 	virtual Qfloat *get_Q(int column, int len) const = 0;
 	virtual double *get_QD() const = 0;
 	virtual void swap_index(int i, int j) const = 0;
+	virtual const svm_parallel *get_parallel() const { return NULL; }
+	// fetch columns[0,n) for [0,len) into data, computing them together when supported;
+	// n must not exceed get_block_size()
+	virtual void get_Q_block(const int *columns, int n, int len, Qfloat **data) const
+	{
+		for(int c=0;c<n;c++)
+			data[c] = get_Q(columns[c],len);
+	}
+	virtual int get_block_size() const { return 1; }
 	virtual ~QMatrix() {}
 };
 
+//
+// Linear kernel columns are computed in blocks of LINEAR_ROWS rows, LINEAR_TILE columns at a time
+//
+#define LINEAR_ROWS 256
+#define LINEAR_TILE 4
+
 class Kernel: public QMatrix {
 public:
 	Kernel(int l, svm_node * const * x, const svm_parameter& param);
@@ -212,14 +274,28 @@ public:
 	{
 		swap(x[i],x[j]);
 		if(x_square) swap(x_square[i],x_square[j]);
+		if(xt)
+			for(int k=0;k<xt_dim;k++)
+				swap(xt[(long int)k*xt_stride+i],xt[(long int)k*xt_stride+j]);
+	}
+	const svm_parallel *get_parallel() const
+	{
+		return parallel;
 	}
 protected:
 
 	double (Kernel::*kernel_function)(int i, int j) const;
+	const svm_parallel *parallel;
+	double *xt;		// linear kernel only: values of x feature after feature, NULL otherwise
+
+	void linear_columns(const int *columns, int n, int start, int len, Qfloat * const *data, const schar *y) const;
+	void fill_linear(Cache *cache, const int *columns, int n, int len, Qfloat **data, const schar *y) const;
 
 private:
 	const svm_node **x;
 	double *x_square;
+	int xt_stride;		// values of each feature in xt (l)
+	int xt_dim;		// features in xt
 
 	// svm_parameter
 	const int kernel_type;
@@ -244,14 +320,16 @@ private:
 	{
 		return tanh(gamma*dot(x[i],x[j])+coef0);
 	}
+#ifndef _DENSE_REP
 	double kernel_precomputed(int i, int j) const
 	{
 		return x[i][(int)(x[j][0].value)].value;
 	}
+#endif
 };
 
 Kernel::Kernel(int l, svm_node * const * x_, const svm_parameter& param)
-:kernel_type(param.kernel_type), degree(param.degree),
+:parallel(param.parallel), kernel_type(param.kernel_type), degree(param.degree),
  gamma(param.gamma), coef0(param.coef0)
 {
 	switch(kernel_type)
@@ -268,9 +346,11 @@ Kernel::Kernel(int l, svm_node * const * x_, const svm_parameter& param)
 		case SIGMOID:
 			kernel_function = &Kernel::kernel_sigmoid;
 			break;
+#ifndef _DENSE_REP
 		case PRECOMPUTED:
 			kernel_function = &Kernel::kernel_precomputed;
 			break;
+#endif
 	}
 
 	clone(x,x_,l);
@@ -283,13 +363,202 @@ Kernel::Kernel(int l, svm_node * const * x_, const svm_parameter& param)
 	}
 	else
 		x_square = 0;
+
+	xt = 0;
+	xt_stride = l;
+	xt_dim = 0;
+#ifdef _DENSE_REP
+	// linear kernel columns are products of the data with one vector, so data is kept
+	// feature after feature and whole blocks of rows are read at once
+	if(kernel_type == LINEAR)
+	{
+		for(int i=0;i<l;i++)
+			xt_dim = max(xt_dim, x[i]->dim);
+		xt = new double[(long int)xt_dim*l];
+		for(int i=0;i<l;i++)
+			for(int k=0;k<xt_dim;k++)
+				xt[(long int)k*l+i] = (k < x[i]->dim) ? x[i]->values[k] : 0;
+	}
+#endif
 }
 
 Kernel::~Kernel()
 {
 	delete[] x;
 	delete[] x_square;
+	delete[] xt;
+}
+
+#ifdef _DENSE_REP
+
+// Dot product of n contiguous values, without SIMD:
+static double dense_dot_scalar(const double *x, const double *y, int n)
+{
+	double sum = 0;
+	for(int k=0;k<n;k++)
+		sum += x[k] * y[k];
+	return sum;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+
+// Dot product of n contiguous values, four at a time with AVX2 lanes:
+__attribute__((target("avx2")))
+static double dense_dot_avx2(const double *x, const double *y, int n)
+{
+	__m256d acc = _mm256_setzero_pd();
+	int k = 0;
+	for(;k+4<=n;k+=4)
+		acc = _mm256_add_pd(acc, _mm256_mul_pd(_mm256_loadu_pd(x+k), _mm256_loadu_pd(y+k)));
+	// Adds up the four lanes, then the remaining values:
+	__m128d half = _mm_add_pd(_mm256_castpd256_pd128(acc), _mm256_extractf128_pd(acc, 1));
+	double sum = _mm_cvtsd_f64(_mm_add_sd(half, _mm_unpackhi_pd(half, half)));
+	for(;k<n;k++)
+		sum += x[k] * y[k];
+	return sum;
+}
+
+// Dot product of n contiguous values, eight at a time with AVX-512 lanes (the tail is a masked load):
+__attribute__((target("avx512f")))
+static double dense_dot_avx512(const double *x, const double *y, int n)
+{
+	__m512d acc = _mm512_setzero_pd();
+	int k = 0;
+	for(;k+8<=n;k+=8)
+		acc = _mm512_add_pd(acc, _mm512_mul_pd(_mm512_loadu_pd(x+k), _mm512_loadu_pd(y+k)));
+	if(k<n)
+	{
+		__mmask8 tail = (__mmask8)((1u << (n-k)) - 1);
+		acc = _mm512_add_pd(acc, _mm512_mul_pd(_mm512_maskz_loadu_pd(tail, x+k), _mm512_maskz_loadu_pd(tail, y+k)));
+	}
+	return _mm512_reduce_add_pd(acc);
+}
+#endif
+
+// Dense dot product, selected once for this CPU:
+typedef double (*dense_dot_kernel)(const double *, const double *, int);
+static dense_dot_kernel select_dense_dot()
+{
+#if defined(__x86_64__) || defined(__i386__)
+	if(__builtin_cpu_supports("avx512f"))
+		return dense_dot_avx512;
+	if(__builtin_cpu_supports("avx2"))
+		return dense_dot_avx2;
+#endif
+	return dense_dot_scalar;
 }
+static const dense_dot_kernel dense_dot = select_dense_dot();
+
+// Computes out[c*LINEAR_ROWS+r] = sum_k xt[k*stride+j0+r] * xt[k*stride+columns[c]] for N columns
+// and count <= LINEAR_ROWS rows, without SIMD:
+template <int N>
+static void linear_tile_scalar(const double *xt, long int stride, int dim, const int *columns, int j0, int count, double *out)
+{
+	for(int r=0;r<count;r++)
+	{
+		double acc[N] = {0};
+		for(int k=0;k<dim;k++)
+		{
+			const double *row = xt + k*stride;
+			for(int c=0;c<N;c++)
+				acc[c] += row[j0+r] * row[columns[c]];
+		}
+		for(int c=0;c<N;c++)
+			out[c*LINEAR_ROWS+r] = acc[c];
+	}
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+
+// Same as linear_tile_scalar, four rows at a time with AVX2 lanes held in N accumulators (the
+// remaining rows use the same fused operations, so no value depends on where a block starts):
+template <int N>
+__attribute__((target("avx2,fma")))
+static void linear_tile_avx2(const double *xt, long int stride, int dim, const int *columns, int j0, int count, double *out)
+{
+	int r = 0;
+	for(;r+4<=count;r+=4)
+	{
+		__m256d acc[N];
+		for(int c=0;c<N;c++)
+			acc[c] = _mm256_setzero_pd();
+		for(int k=0;k<dim;k++)
+		{
+			const double *row = xt + k*stride;
+			__m256d v = _mm256_loadu_pd(row+j0+r);
+			for(int c=0;c<N;c++)
+				acc[c] = _mm256_fmadd_pd(v, _mm256_set1_pd(row[columns[c]]), acc[c]);
+		}
+		for(int c=0;c<N;c++)
+			_mm256_storeu_pd(out+c*LINEAR_ROWS+r, acc[c]);
+	}
+	for(;r<count;r++)
+	{
+		double acc[N] = {0};
+		for(int k=0;k<dim;k++)
+		{
+			const double *row = xt + k*stride;
+			for(int c=0;c<N;c++)
+				acc[c] = __builtin_fma(row[j0+r], row[columns[c]], acc[c]);
+		}
+		for(int c=0;c<N;c++)
+			out[c*LINEAR_ROWS+r] = acc[c];
+	}
+}
+
+// Same as linear_tile_scalar, eight rows at a time with AVX-512 lanes held in N accumulators (the
+// last rows are a masked load):
+template <int N>
+__attribute__((target("avx512f,fma")))
+static void linear_tile_avx512(const double *xt, long int stride, int dim, const int *columns, int j0, int count, double *out)
+{
+	for(int r=0;r<count;r+=8)
+	{
+		__mmask8 rows = (count-r >= 8) ? (__mmask8)0xFF : (__mmask8)((1u << (count-r)) - 1);
+		__m512d acc[N];
+		for(int c=0;c<N;c++)
+			acc[c] = _mm512_setzero_pd();
+		for(int k=0;k<dim;k++)
+		{
+			const double *row = xt + k*stride;
+			__m512d v = _mm512_maskz_loadu_pd(rows, row+j0+r);
+			for(int c=0;c<N;c++)
+				acc[c] = _mm512_fmadd_pd(v, _mm512_set1_pd(row[columns[c]]), acc[c]);
+		}
+		for(int c=0;c<N;c++)
+			_mm512_mask_storeu_pd(out+c*LINEAR_ROWS+r, rows, acc[c]);
+	}
+}
+#endif
+
+// Tile kernels for 1 to LINEAR_TILE columns, selected once for this CPU:
+typedef void (*linear_tile_kernel)(const double *, long int, int, const int *, int, int, double *);
+static const linear_tile_kernel linear_tiles_scalar[LINEAR_TILE] =
+	{ linear_tile_scalar<1>, linear_tile_scalar<2>, linear_tile_scalar<3>, linear_tile_scalar<4> };
+#if defined(__x86_64__) || defined(__i386__)
+static const linear_tile_kernel linear_tiles_avx2[LINEAR_TILE] =
+	{ linear_tile_avx2<1>, linear_tile_avx2<2>, linear_tile_avx2<3>, linear_tile_avx2<4> };
+static const linear_tile_kernel linear_tiles_avx512[LINEAR_TILE] =
+	{ linear_tile_avx512<1>, linear_tile_avx512<2>, linear_tile_avx512<3>, linear_tile_avx512<4> };
+#endif
+static const linear_tile_kernel *select_linear_tiles()
+{
+#if defined(__x86_64__) || defined(__i386__)
+	if(__builtin_cpu_supports("avx512f"))
+		return linear_tiles_avx512;
+	if(__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+		return linear_tiles_avx2;
+#endif
+	return linear_tiles_scalar;
+}
+static const linear_tile_kernel *linear_tiles = select_linear_tiles();
+
+double Kernel::dot(const svm_node *px, const svm_node *py)
+{
+	return dense_dot(px->values, py->values, min(px->dim, py->dim));
+}
+
+#else
 
 double Kernel::dot(const svm_node *px, const svm_node *py)
 {
@@ -313,6 +582,54 @@ double Kernel::dot(const svm_node *px, const svm_node *py)
 	return sum;
 }
 
+#endif
+
+// fill data[c][j] = K(columns[c],j), times y[columns[c]]*y[j] if y is set, for j in [start,len)
+void Kernel::linear_columns(const int *columns, int n, int start, int len, Qfloat * const *data, const schar *y) const
+{
+#ifdef _DENSE_REP
+	double out[LINEAR_TILE*LINEAR_ROWS];
+	for(int c0=0;c0<n;c0+=LINEAR_TILE)
+	{
+		int nc = min(LINEAR_TILE, n-c0);
+		for(int j0=start;j0<len;j0+=LINEAR_ROWS)
+		{
+			int count = min(LINEAR_ROWS, len-j0);
+			linear_tiles[nc-1](xt, xt_stride, xt_dim, columns+c0, j0, count, out);
+			for(int c=0;c<nc;c++)
+			{
+				Qfloat *d = data[c0+c] + j0;
+				const double *o = out + c*LINEAR_ROWS;
+				if(y)
+				{
+					schar yc = y[columns[c0+c]];
+					for(int r=0;r<count;r++)
+						d[r] = (Qfloat)(yc*y[j0+r]*o[r]);
+				}
+				else
+					for(int r=0;r<count;r++)
+						d[r] = (Qfloat)o[r];
+			}
+		}
+	}
+#endif
+}
+
+// fetch columns[0,n) for [0,len) from cache, computing the rows missing in any of them together
+void Kernel::fill_linear(Cache *cache, const int *columns, int n, int len, Qfloat **data, const schar *y) const
+{
+	int start = len;
+	for(int c=0;c<n;c++)
+		start = min(start, cache->get_data(columns[c],&data[c],len));
+	if(start < len)
+	{
+		parallel_range(parallel, start, len, [&](int begin, int end)
+		{
+			linear_columns(columns, n, begin, end, data, y);
+		});
+	}
+}
+
 double Kernel::k_function(const svm_node *x, const svm_node *y,
 			  const svm_parameter& param)
 {
@@ -325,6 +642,18 @@ double Kernel::k_function(const svm_node *x, const svm_node *y,
 		case RBF:
 		{
 			double sum = 0;
+#ifdef _DENSE_REP
+			int dim = min(x->dim, y->dim), k;
+			for(k=0;k<dim;k++)
+			{
+				double d = x->values[k] - y->values[k];
+				sum += d*d;
+			}
+			for(k=dim;k<x->dim;k++)
+				sum += x->values[k] * x->values[k];
+			for(k=dim;k<y->dim;k++)
+				sum += y->values[k] * y->values[k];
+#else
 			while(x->index != -1 && y->index !=-1)
 			{
 				if(x->index == y->index)
@@ -360,13 +689,16 @@ double Kernel::k_function(const svm_node *x, const svm_node *y,
 				sum += y->value * y->value;
 				++y;
 			}
+#endif
 
 			return exp(-param.gamma*sum);
 		}
 		case SIGMOID:
 			return tanh(param.gamma*dot(x,y)+param.coef0);
+#ifndef _DENSE_REP
 		case PRECOMPUTED:  //x: test (validation), y: SV
 			return x[(int)(y->value)].value;
+#endif
 		default:
 			return 0;  // Unreachable
 	}
@@ -478,27 +810,45 @@ void Solver::reconstruct_gradient()
 	if(2*nr_free < active_size)
 		info("\nWARNING: using -h 0 may be faster\n");
 
+	// columns are fetched in blocks, so the kernel can compute several at once
+	int block = Q->get_block_size();
+	int *columns = new int[block];
+	Qfloat **Q_c = new Qfloat*[block];
+
 	if (nr_free*l > 2*active_size*(l-active_size))
 	{
-		for(i=active_size;i<l;i++)
+		for(i=active_size;i<l;i+=block)
 		{
-			const Qfloat *Q_i = Q->get_Q(i,active_size);
-			for(j=0;j<active_size;j++)
-				if(is_free(j))
-					G[i] += alpha[j] * Q_i[j];
+			int n = min(block, l-i);
+			for(int c=0;c<n;c++)
+				columns[c] = i+c;
+			Q->get_Q_block(columns,n,active_size,Q_c);
+			for(int c=0;c<n;c++)
+				for(j=0;j<active_size;j++)
+					if(is_free(j))
+						G[i+c] += alpha[j] * Q_c[c][j];
 		}
 	}
 	else
 	{
-		for(i=0;i<active_size;i++)
-			if(is_free(i))
+		for(i=0;i<active_size;)
+		{
+			int n = 0;
+			for(;i<active_size && n<block;i++)
+				if(is_free(i))
+					columns[n++] = i;
+			Q->get_Q_block(columns,n,l,Q_c);
+			for(int c=0;c<n;c++)
 			{
-				const Qfloat *Q_i = Q->get_Q(i,l);
-				double alpha_i = alpha[i];
+				double alpha_i = alpha[columns[c]];
 				for(j=active_size;j<l;j++)
-					G[j] += alpha_i * Q_i[j];
+					G[j] += alpha_i * Q_c[c][j];
 			}
+		}
 	}
+
+	delete[] columns;
+	delete[] Q_c;
 }
 
 void Solver::Solve(int l, const QMatrix& Q, const double *p_, const schar *y_,
@@ -691,10 +1041,11 @@ void Solver::Solve(int l, const QMatrix& Q, const double *p_, const schar *y_,
 		double delta_alpha_i = alpha[i] - old_alpha_i;
 		double delta_alpha_j = alpha[j] - old_alpha_j;
 
-		for(int k=0;k<active_size;k++)
+		parallel_range(Q.get_parallel(), 0, active_size, [&](int begin, int end)
 		{
-			G[k] += Q_i[k]*delta_alpha_i + Q_j[k]*delta_alpha_j;
-		}
+			for(int k=begin;k<end;k++)
+				G[k] += Q_i[k]*delta_alpha_i + Q_j[k]*delta_alpha_j;
+		});
 
 		// update alpha_status and G_bar
 
@@ -1279,15 +1630,37 @@ public:
 	Qfloat *get_Q(int i, int len) const
 	{
 		Qfloat *data;
-		int start, j;
+		if(xt)
+		{
+			fill_linear(cache,&i,1,len,&data,y);
+			return data;
+		}
+		int start;
 		if((start = cache->get_data(i,&data,len)) < len)
 		{
-			for(j=start;j<len;j++)
-				data[j] = (Qfloat)(y[i]*y[j]*(this->*kernel_function)(i,j));
+			parallel_range(parallel, start, len, [&](int begin, int end)
+			{
+				for(int j=begin;j<end;j++)
+					data[j] = (Qfloat)(y[i]*y[j]*(this->*kernel_function)(i,j));
+			});
 		}
 		return data;
 	}
 
+	void get_Q_block(const int *columns, int n, int len, Qfloat **data) const
+	{
+		if(xt)
+			fill_linear(cache,columns,n,len,data,y);
+		else
+			QMatrix::get_Q_block(columns,n,len,data);
+	}
+
+	int get_block_size() const
+	{
+		// every column of a block must stay cached until the block is filled
+		return xt ? min(LINEAR_TILE, cache->get_num_slots()) : 1;
+	}
+
 	double *get_QD() const
 	{
 		return QD;
@@ -1328,15 +1701,37 @@ public:
 	Qfloat *get_Q(int i, int len) const
 	{
 		Qfloat *data;
-		int start, j;
+		if(xt)
+		{
+			fill_linear(cache,&i,1,len,&data,NULL);
+			return data;
+		}
+		int start;
 		if((start = cache->get_data(i,&data,len)) < len)
 		{
-			for(j=start;j<len;j++)
-				data[j] = (Qfloat)(this->*kernel_function)(i,j);
+			parallel_range(parallel, start, len, [&](int begin, int end)
+			{
+				for(int j=begin;j<end;j++)
+					data[j] = (Qfloat)(this->*kernel_function)(i,j);
+			});
 		}
 		return data;
 	}
 
+	void get_Q_block(const int *columns, int n, int len, Qfloat **data) const
+	{
+		if(xt)
+			fill_linear(cache,columns,n,len,data,NULL);
+		else
+			QMatrix::get_Q_block(columns,n,len,data);
+	}
+
+	int get_block_size() const
+	{
+		// every column of a block must stay cached until the block is filled
+		return xt ? min(LINEAR_TILE, cache->get_num_slots()) : 1;
+	}
+
 	double *get_QD() const
 	{
 		return QD;
@@ -1472,6 +1867,209 @@ static void solve_c_svc(
 	delete[] y;
 }
 
+// Helpers for the linear solver, which keeps the weight vector w explicitly:
+
+// Number of weights needed by the vectors of prob (its largest feature index):
+static int linear_dims(const svm_problem *prob)
+{
+	int n = 0;
+	for(int i=0;i<prob->l;i++)
+	{
+#ifdef _DENSE_REP
+		n = max(n, prob->x[i]->dim);
+#else
+		for(const svm_node *px=prob->x[i];px->index!=-1;++px)
+			n = max(n, px->index);
+#endif
+	}
+	return n;
+}
+
+// w^T x:
+static double linear_dot(const double *w, const svm_node *x)
+{
+#ifdef _DENSE_REP
+	return dense_dot(w, x->values, x->dim);
+#else
+	double sum = 0;
+	for(;x->index!=-1;++x)
+		sum += w[x->index-1] * x->value;
+	return sum;
+#endif
+}
+
+// x^T x:
+static double linear_norm2(const svm_node *x)
+{
+#ifdef _DENSE_REP
+	return dense_dot(x->values, x->values, x->dim);
+#else
+	double sum = 0;
+	for(;x->index!=-1;++x)
+		sum += x->value * x->value;
+	return sum;
+#endif
+}
+
+// w += a x:
+static void linear_axpy(double a, const svm_node *x, double *w)
+{
+#ifdef _DENSE_REP
+	for(int k=0;k<x->dim;k++)
+		w[k] += a * x->values[k];
+#else
+	for(;x->index!=-1;++x)
+		w[x->index-1] += a * x->value;
+#endif
+}
+
+// A dual coordinate descent method for the linear (L1-loss) SVM, as in Hsieh et al., ICML 2008 (the
+// LIBLINEAR solver). Unlike solve_c_svc, it solves the bias-regularized problem: the bias is learned as
+// the weight of an extra constant feature of value 1, so it is penalized along with w and the dual has
+// no sum y_i alpha_i = 0 constraint. It updates one alpha at a time against w = sum alpha_i y_i x_i, so
+// each pass costs O(l * dims) and no kernel columns are ever computed. Inactive alphas are shrunk the
+// same way LIBLINEAR does.
+static void solve_c_svc_linear(
+	const svm_problem *prob, const svm_parameter* param,
+	double *alpha, Solver::SolutionInfo* si, double Cp, double Cn)
+{
+	int l = prob->l;
+	int n = linear_dims(prob);
+	const int max_iter = 10000;	// large C converges slowly, and shrunk passes are cheap
+	double *w = new double[n];
+	double bias_w = 0;
+	double *QD = new double[l];
+	int *index = new int[l];
+	schar *y = new schar[l];
+	int i, s, iter = 0;
+	int active_size = l;
+
+	// PG: projected gradient, for shrinking and stopping
+	double PGmax_old = INF;
+	double PGmin_old = -INF;
+
+	// Own generator, so threads training clusters at once get the same orders as a sequential run
+	unsigned int seed = 1;
+
+	for(i=0;i<n;i++)
+		w[i] = 0;
+	for(i=0;i<l;i++)
+	{
+		alpha[i] = 0;
+		if(prob->y[i] > 0) y[i] = +1; else y[i] = -1;
+		QD[i] = linear_norm2(prob->x[i]) + 1;
+		index[i] = i;
+	}
+
+	while(iter < max_iter)
+	{
+		double PGmax_new = -INF;
+		double PGmin_new = INF;
+
+		for(i=0;i<active_size;i++)
+		{
+			seed = seed * 1103515245 + 12345;
+			int j = i + (seed >> 16) % (active_size-i);
+			swap(index[i], index[j]);
+		}
+
+		for(s=0;s<active_size;s++)
+		{
+			i = index[s];
+			const schar yi = y[i];
+			const double C = (yi > 0) ? Cp : Cn;
+			double G = yi * (linear_dot(w, prob->x[i]) + bias_w) - 1;
+			double PG = 0;
+
+			if(alpha[i] == 0)
+			{
+				if(G > PGmax_old)
+				{
+					active_size--;
+					swap(index[s], index[active_size]);
+					s--;
+					continue;
+				}
+				else if(G < 0)
+					PG = G;
+			}
+			else if(alpha[i] == C)
+			{
+				if(G < PGmin_old)
+				{
+					active_size--;
+					swap(index[s], index[active_size]);
+					s--;
+					continue;
+				}
+				else if(G > 0)
+					PG = G;
+			}
+			else
+				PG = G;
+
+			PGmax_new = max(PGmax_new, PG);
+			PGmin_new = min(PGmin_new, PG);
+
+			if(fabs(PG) > 1.0e-12)
+			{
+				double alpha_old = alpha[i];
+				alpha[i] = min(max(alpha[i] - G/QD[i], 0.0), C);
+				double d = (alpha[i] - alpha_old) * yi;
+				linear_axpy(d, prob->x[i], w);
+				bias_w += d;
+			}
+		}
+
+		iter++;
+
+		if(PGmax_new - PGmin_new <= param->eps)
+		{
+			if(active_size == l)
+				break;
+			else
+			{
+				// Checks the shrunk variables once more before stopping
+				active_size = l;
+				PGmax_old = INF;
+				PGmin_old = -INF;
+				continue;
+			}
+		}
+		PGmax_old = PGmax_new;
+		PGmin_old = PGmin_new;
+		if(PGmax_old <= 0)
+			PGmax_old = INF;
+		if(PGmin_old >= 0)
+			PGmin_old = -INF;
+	}
+
+	if(iter >= max_iter)
+		info("\nWARNING: reaching max number of iterations\n");
+
+	// Objective of the dual, and alphas signed by class as solve_c_svc leaves them
+	double v = bias_w * bias_w;
+	for(i=0;i<n;i++)
+		v += w[i] * w[i];
+	si->obj = v/2;
+	for(i=0;i<l;i++)
+	{
+		si->obj -= alpha[i];
+		alpha[i] *= y[i];
+	}
+	// Decision value is w^T x + bias_w, and libsvm subtracts rho
+	si->rho = -bias_w;
+	si->upper_bound_p = Cp;
+	si->upper_bound_n = Cn;
+
+	info("optimization finished, #iter = %d\n",iter);
+
+	delete[] w;
+	delete[] QD;
+	delete[] index;
+	delete[] y;
+}
+
 static void solve_nu_svc(
 	const svm_problem *prob, const svm_parameter *param,
 	double *alpha, Solver::SolutionInfo* si)
@@ -1653,7 +2251,10 @@ static decision_function svm_train_one(
 	switch(param->svm_type)
 	{
 		case C_SVC:
-			solve_c_svc(prob,param,alpha,&si,Cp,Cn);
+			if(param->kernel_type == LINEAR && param->linear_solver)
+				solve_c_svc_linear(prob,param,alpha,&si,Cp,Cn);
+			else
+				solve_c_svc(prob,param,alpha,&si,Cp,Cn);
 			break;
 		case NU_SVC:
 			solve_nu_svc(prob,param,alpha,&si);
@@ -2714,6 +3315,10 @@ int svm_save_model(const char *model_file_name, const svm_model *model)
 
 		const svm_node *p = SV[i];
 
+#ifdef _DENSE_REP
+		for(int k=0;k<p->dim;k++)
+			fprintf(fp,"%d:%.8g ",k+1,p->values[k]);
+#else
 		if(param.kernel_type == PRECOMPUTED)
 			fprintf(fp,"0:%d ",(int)(p->value));
 		else
@@ -2722,6 +3327,7 @@ int svm_save_model(const char *model_file_name, const svm_model *model)
 				fprintf(fp,"%d:%.8g ",p->index,p->value);
 				p++;
 			}
+#endif
 		fprintf(fp, "\n");
 	}
 
@@ -2906,6 +3512,18 @@ svm_model *svm_load_model(const char *model_file_name)
 
 	while(readline(fp)!=NULL)
 	{
+#ifdef _DENSE_REP
+		// Each vector takes as many values as its largest index:
+		int max_index = 0;
+		p = strtok(line," \t");
+		while(p != NULL)
+		{
+			if(strchr(p,':') != NULL)
+				max_index = max(max_index, (int) strtol(p,&endptr,10));
+			p = strtok(NULL," \t");
+		}
+		elements += max_index;
+#else
 		p = strtok(line,":");
 		while(1)
 		{
@@ -2914,8 +3532,11 @@ svm_model *svm_load_model(const char *model_file_name)
 				break;
 			++elements;
 		}
+#endif
 	}
+#ifndef _DENSE_REP
 	elements += model->l;
+#endif
 
 	fseek(fp,pos,SEEK_SET);
 
@@ -2927,13 +3548,28 @@ svm_model *svm_load_model(const char *model_file_name)
 		model->sv_coef[i] = Malloc(double,l);
 	model->SV = Malloc(svm_node*,l);
 	svm_node *x_space = NULL;
+#ifdef _DENSE_REP
+	double *values = NULL;
+	if(l>0)
+	{
+		x_space = Malloc(svm_node,l);
+		values = Malloc(double,max(elements,1));
+	}
+#else
 	if(l>0) x_space = Malloc(svm_node,elements);
+#endif
 
 	int j=0;
 	for(i=0;i<l;i++)
 	{
 		readline(fp);
+#ifdef _DENSE_REP
+		model->SV[i] = &x_space[i];
+		x_space[i].values = &values[j];
+		x_space[i].dim = 0;
+#else
 		model->SV[i] = &x_space[j];
+#endif
 
 		p = strtok(line, " \t");
 		model->sv_coef[0][i] = strtod(p,&endptr);
@@ -2950,12 +3586,24 @@ svm_model *svm_load_model(const char *model_file_name)
 
 			if(val == NULL)
 				break;
+#ifdef _DENSE_REP
+			// Missing indices hold zeros:
+			int index = (int) strtol(idx,&endptr,10);
+			if(index < 1)
+				continue;
+			while(x_space[i].dim < index)
+				x_space[i].values[x_space[i].dim++] = 0;
+			x_space[i].values[index-1] = strtod(val,&endptr);
+		}
+		j += x_space[i].dim;
+#else
 			x_space[j].index = (int) strtol(idx,&endptr,10);
 			x_space[j].value = strtod(val,&endptr);
 
 			++j;
 		}
 		x_space[j++].index = -1;
+#endif
 	}
 	free(line);
 
@@ -2972,7 +3620,12 @@ svm_model *svm_load_model(const char *model_file_name)
 void svm_free_model_content(svm_model* model_ptr)
 {
 	if(model_ptr->free_sv && model_ptr->l > 0 && model_ptr->SV != NULL)
+	{
+#ifdef _DENSE_REP
+		free((void *)(model_ptr->SV[0]->values));
+#endif
 		free((void *)(model_ptr->SV[0]));
+	}
 	if(model_ptr->sv_coef)
 	{
 		for(int i=0;i<model_ptr->nr_class-1;i++)
@@ -3042,6 +3695,11 @@ const char *svm_check_parameter(const svm_problem *prob, const svm_parameter *pa
 	   kernel_type != PRECOMPUTED)
 		return "unknown kernel type";
 
+#ifdef _DENSE_REP
+	if(kernel_type == PRECOMPUTED)
+		return "precomputed kernel needs sparse vectors (undefine _DENSE_REP)";
+#endif
+
 	if(param->gamma < 0)
 		return "gamma < 0";
 